@@ -0,0 +1,181 @@
+//  This file is part of Project Name
+//  Copyright (C) Michigan State University, 2020.
+//  Released under the MIT Software license; see doc/LICENSE
+//
+//  Times the SimplePDWorld and QueueManager hot paths over a grid of population sizes (N) and
+//  neighborhood radii (r), and prints the results as one JSON document.
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "base/vector.h"
+#include "configsetup.h"
+#include "pdimage.h"
+#include "queue-manager.h"
+#include "simplepdworld.h"
+
+using bench_clock = std::chrono::steady_clock;
+
+volatile size_t bench_sink;  // Results of calls that must not be optimized away.
+
+double SecondsSince(bench_clock::time_point start) {
+    return std::chrono::duration<double>(bench_clock::now() - start).count();
+}
+
+// Each benchmark result is one JSON object; keep track of whether a comma is needed before it.
+class Report {
+   private:
+    std::ostream& os;
+    bool first = true;
+
+   public:
+    Report(std::ostream& _os, const std::string& label) : os(_os) {
+        os << "{\n  \"label\": \"" << label << "\",\n  \"kernels\": \""
+           << emp::pdkernels::DescribeKernels() << "\",\n  \"results\": [";
+    }
+    ~Report() { os << "\n  ]\n}" << std::endl; }
+
+    /// @param count how many operations the timed section performed (for a per-second rate)
+    void Add(const std::string& name, size_t N, double r, double seconds, size_t count) {
+        os << (first ? "\n" : ",\n") << "    {\"name\": \"" << name << "\", \"N\": " << N << ", \"r\": " << r
+           << ", \"seconds\": " << seconds << ", \"count\": " << count
+           << ", \"per_sec\": " << (seconds > 0.0 ? (double)count / seconds : 0.0) << "}";
+        first = false;
+    }
+};
+
+// Best of several repeats, to keep scheduler noise out of short timings.
+template <typename FUN_T>
+double BestOf(size_t repeats, FUN_T&& fun) {
+    double best = -1.0;
+    for (size_t i = 0; i < repeats; i++) {
+        const auto start = bench_clock::now();
+        fun();
+        const double seconds = SecondsSince(start);
+        if (best < 0.0 || seconds < best) best = seconds;
+    }
+    return best;
+}
+
+void BenchWorld(Report& report, size_t N, double r, size_t epochs) {
+    emp::SimplePDWorld world(r, 0.175, N, epochs, false, 1);
+
+    double seconds = BestOf(3, [&]() { world.Setup(r, 0.175, N, epochs); });
+    report.Add("setup", N, r, seconds, 1);
+
+    const size_t fitness_passes = 10;
+    seconds = BestOf(3, [&]() {
+        for (size_t pass = 0; pass < fitness_passes; pass++) {
+            for (size_t id = 0; id < N; id++) world.CalcFitness(id);
+        }
+    });
+    report.Add("calc_fitness", N, r, seconds, fitness_passes * N);
+
+    const size_t count_calls = 1000;
+    seconds = BestOf(3, [&]() {
+        for (size_t i = 0; i < count_calls; i++) bench_sink = world.CountCoop();
+    });
+    report.Add("count_coop", N, r, seconds, count_calls);
+
+    seconds = BestOf(3, [&]() {
+        for (size_t i = 0; i < count_calls; i++) bench_sink = world.RecountCoop();
+    });
+    report.Add("recount_coop", N, r, seconds, count_calls);
+
+    world.Setup(r, 0.175, N, epochs);
+    const auto start = bench_clock::now();
+    world.Run(epochs);
+    seconds = SecondsSince(start);
+    report.Add("run_epochs", N, r, seconds, epochs);
+    report.Add("run_repro", N, r, seconds, epochs * N);
+
+    world.SetEventDriven(true);
+    world.Setup(r, 0.175, N, epochs);
+    seconds = BestOf(1, [&]() { world.Run(epochs); });
+    report.Add("run_epochs_event", N, r, seconds, epochs);
+    world.SetEventDriven(false);
+
+    // The web page's canvas: drawing every organism, then only those changed by an epoch.
+    emp::vector<float> pos_x(N), pos_y(N);
+    for (size_t id = 0; id < N; id++) {
+        pos_x[id] = (float)world.GetX(id);
+        pos_y[id] = (float)world.GetY(id);
+    }
+    emp::PDImage image(600, 600);
+    image.SetPositions(pos_x, pos_y);
+    const size_t frames = 100;
+    seconds = BestOf(3, [&]() {
+        for (size_t frame = 0; frame < frames; frame++) {
+            image.SetHighlight(-1.0, -1.0, -1.0);  // Forces a full redraw
+            bench_sink = image.Update(world.coop_bits);
+        }
+    });
+    report.Add("image_full", N, r, seconds, frames);
+
+    world.Setup(r, 0.175, N, epochs);
+    image.Update(world.coop_bits);
+    seconds = 0.0;
+    for (size_t frame = 0; frame < frames; frame++) {
+        world.Run(1);
+        const auto start = bench_clock::now();
+        bench_sink = image.Update(world.coop_bits);
+        seconds += SecondsSince(start);
+    }
+    report.Add("image_update", N, r, seconds, frames);
+}
+
+void BenchQueue(Report& report, size_t num_runs) {
+    emp::SettingConfig config = emp::setup();
+
+    double seconds = BestOf(3, [&]() {
+        emp::QueueManager queue(config);
+        for (size_t i = 0; i < num_runs; i++) queue.AddRun(config);
+    });
+    report.Add("queue_enqueue", 0, 0.0, seconds, num_runs);
+
+    emp::QueueManager queue(config);
+    for (size_t i = 0; i < num_runs; i++) queue.AddRun(config);
+    emp::RunInfo run;
+    auto start = bench_clock::now();
+    while (queue.PopRun(run)) { ; }
+    report.Add("queue_dequeue", 0, 0.0, SecondsSince(start), num_runs);
+
+    // Table updates: one DivTableCalc per simulated animation frame, as the web driver does.
+    emp::QueueManager table_queue(config);
+    const size_t coop_slot = table_queue.AddMetric("Num Coop");
+    const size_t defect_slot = table_queue.AddMetric("Num Defect");
+    table_queue.DivAddTable(1, 8, "bench_tab");
+    table_queue.AddRuns(config, 1);
+    table_queue.DivButtonTable(0, 1);
+    table_queue.DivRedrawTable();
+    const size_t frames = 10000;
+    start = bench_clock::now();
+    for (size_t frame = 0; frame < frames; frame++) {
+        table_queue.SetEpoch(frame % 1000);
+        table_queue.SetMetric(coop_slot, (double)frame);
+        table_queue.SetMetric(defect_slot, (double)(6400 - frame % 6400));
+        table_queue.DivTableCalc();
+    }
+    report.Add("queue_table_update", 0, 0.0, SecondsSince(start), frames);
+}
+
+int main(int argc, char* argv[]) {
+    bool quick = false;
+    std::string label;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--quick") quick = true;
+        else if (arg == "--label" && i + 1 < argc) label = argv[++i];
+    }
+
+    const emp::vector<size_t> N_values = quick ? emp::vector<size_t>{1600, 6400} : emp::vector<size_t>{1600, 6400, 25600};
+    const emp::vector<double> r_values = quick ? emp::vector<double>{0.02} : emp::vector<double>{0.01, 0.02, 0.05};
+    const size_t epochs = quick ? 10 : 50;
+
+    Report report(std::cout, label);
+    for (size_t N : N_values) {
+        for (double r : r_values) BenchWorld(report, N, r, epochs);
+    }
+    BenchQueue(report, quick ? 10000 : 100000);
+}
@@ -0,0 +1,393 @@
+/**
+ *  @note This file is part of Empirical, https://github.com/devosoft/Empirical
+ *  @copyright Copyright (C) Michigan State University, MIT Software license; see doc/LICENSE.md
+ *  @date 2020
+ *
+ *  @file  batchrunner.h
+ *  @brief Drains a QueueManager headlessly, running each queued SimplePDWorld on a pool of worker threads.
+ *  @note Status:
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "base/vector.h"
+#include "binaryio.h"
+#include "perfcounters.h"
+#include "queue-manager.h"
+#include "recorder.h"
+#include "sharedqueue.h"
+#include "simplepdworld.h"
+#include "worlddriver.h"
+
+namespace emp {
+
+/// Final state of one finished run.
+struct RunResult {
+    size_t id;
+    size_t point_id;
+    uint64_t seed;
+    double r;
+    double u;
+    size_t N;
+    size_t E;
+    size_t epoch;
+    size_t num_coop;
+    double mean_fitness;
+    StopReason stop_reason;
+    double seconds;  // Wall-clock time spent on this run (including Setup) since this process started it
+};
+
+/// Runs every queued run to its E_value (or one of its stop conditions) on a fixed number of worker threads. Each worker owns one
+/// WorldDriver<SimplePDWorld> and reuses its world for every run it takes off the queue. Since each run starts over
+/// from its own seed, results do not depend on the number of workers or the order runs finish in.
+///
+/// With a checkpoint directory set, the queue (including runs in progress) is saved to
+/// queue.ckpt whenever a run starts or finishes, and each run in progress saves its world to
+/// run-<id>.ckpt every checkpoint_every epochs. After a crash, QueueManager::LoadQueue on
+/// queue.ckpt and a new Run() continue every run from its last checkpoint, bit-identically.
+/// (A run that finished just before the crash may be reported twice, with identical results, and
+/// a resumed run's series may repeat the samples taken between its last checkpoint and the crash.)
+///
+/// With a SeriesWriter set, every run also records its time series (see recorder.h).
+///
+/// Every run samples its cooperator fraction at the queue's summary epochs and adds them to its
+/// point's cross-replicate summary when it finishes (see QueueManager::AddRunSamples). With a
+/// summary stream set, each point's summary is written there once its last replicate finishes,
+/// and then dropped, so memory only grows with the number of points in progress.
+///
+/// With a SharedQueue set, runs are leased from the queue in its directory instead, alongside
+/// any other processes working on it, and results and summaries go to that directory's files
+/// (see sharedqueue.h). Run checkpoints are then kept in the same directory, so a run taken over
+/// from a process that died continues from its last checkpoint.
+///
+/// With a stats stream set, a JSON line of progress is written there every few seconds while the
+/// queue drains, and once more at the end. Built with QM_PERF=1, it also holds the counters of
+/// every worker's world (added up after each stretch of epochs) and the queue's timers (see
+/// perfcounters.h).
+class BatchRunner {
+   private:
+    QueueManager& queue;
+    size_t num_threads;
+
+    std::ostream& os;
+    std::mutex os_mutex;
+
+    std::string checkpoint_dir;   // Empty for no checkpoints
+    size_t checkpoint_every = 0;  // Epochs between world checkpoints
+    std::map<size_t, RunInfo> in_flight;  // Runs taken off the queue but not yet finished, by id
+    std::mutex checkpoint_mutex;          // Guards in_flight and the queue checkpoint file
+
+    SeriesWriter* series_writer = nullptr;  // nullptr for no time series
+    size_t series_interval = 10;            // Epochs between time-series samples
+
+    bool event_driven = false;  // Run worlds in event-driven mode (see SimplePDWorld::SetEventDriven)
+    size_t parallel_tiles = 0;    // Tiles per side of the parallel update (see SimplePDWorld::SetParallel; 0 for none)
+    size_t parallel_threads = 1;  // Threads each world's parallel update runs on
+
+    std::ostream* summary_os = nullptr;  // nullptr to keep summaries in the queue instead
+    std::mutex summary_os_mutex;
+
+    SharedQueue* shared = nullptr;  // nullptr to work on queue alone
+
+    std::ostream* stats_os = nullptr;  // nullptr for no stats lines
+    double stats_every = 10.0;         // Seconds between stats lines
+    WorldPerf world_totals;            // Counters of every world so far
+    size_t runs_finished = 0;
+    std::chrono::steady_clock::time_point run_start;
+    bool workers_done = false;
+    std::mutex stats_mutex;            // Guards the four above
+    std::condition_variable stats_cv;  // Signalled when the workers are done
+
+    /// Adds a world's counters since the last call to the totals.
+    void AddWorldPerf(SimplePDWorld& world) {
+        const WorldPerf perf = world.TakePerf();
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        world_totals += perf;
+    }
+
+    /// Writes a stats line every stats_every seconds until the workers are done, then a last one.
+    void StatsLoop() {
+        std::unique_lock<std::mutex> lock(stats_mutex);
+        while (!stats_cv.wait_for(lock, std::chrono::duration<double>(stats_every), [this]() { return workers_done; })) {
+            lock.unlock();
+            WriteStats(*stats_os);
+            lock.lock();
+        }
+        lock.unlock();
+        WriteStats(*stats_os);
+    }
+
+    std::string RunCheckpointName(size_t id) const { return checkpoint_dir + "/run-" + std::to_string(id) + ".ckpt"; }
+    std::string QueueCheckpointName() const { return checkpoint_dir + "/queue.ckpt"; }
+
+    /// Saves the queue plus in-flight runs (checkpoint_mutex must be held).
+    void SaveQueueCheckpoint() {
+        emp::vector<RunInfo> runs_in_flight;
+        for (const auto& p : in_flight) runs_in_flight.push_back(p.second);
+        WriteFileAtomic(QueueCheckpointName(), [this, &runs_in_flight](std::ostream& out) {
+            queue.SaveQueue(out, runs_in_flight);
+        });
+    }
+
+    /// Takes the next run off the queue; with checkpoints on, it is recorded as in flight in the
+    /// same step, so a queue checkpoint never misses it.
+    bool TakeRun(RunInfo& run) {
+        if (shared) return shared->TakeRun(run);
+        if (checkpoint_dir.empty()) return queue.PopRun(run);
+        std::lock_guard<std::mutex> lock(checkpoint_mutex);
+        if (!queue.PopRun(run)) return false;
+        in_flight[run.id] = run;
+        SaveQueueCheckpoint();
+        return true;
+    }
+
+    /// Reports a finished run and adds its samples to its point's summary; with checkpoints on,
+    /// this happens in the same step as the run leaves in_flight, so a queue checkpoint never
+    /// counts a run twice or not at all.
+    void FinishRun(const RunInfo& run, const emp::vector<double>& samples, const RunResult& result) {
+        queue.AddRunTime(result.seconds);
+        {
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            runs_finished++;
+        }
+        if (shared) {
+            // A run that could not be recorded keeps its checkpoint, for whichever process runs it
+            // again; the error stops this process's workers (see SharedQueue::GetError).
+            if (shared->Finish(run, samples, FormatResult(result))) std::remove(RunCheckpointName(run.id).c_str());
+            return;
+        }
+        PrintResult(result);
+        bool point_done = false;
+        if (checkpoint_dir.empty()) {
+            point_done = queue.AddRunSamples(run, samples);
+        } else {
+            std::lock_guard<std::mutex> lock(checkpoint_mutex);
+            point_done = queue.AddRunSamples(run, samples);
+            in_flight.erase(run.id);
+            SaveQueueCheckpoint();
+            std::remove(RunCheckpointName(run.id).c_str());
+        }
+        if (point_done && summary_os) {
+            std::lock_guard<std::mutex> lock(summary_os_mutex);
+            queue.WriteSummary(*summary_os, run.point_id);
+            queue.RemoveSummary(run.point_id);
+        }
+    }
+
+    /// Starts the driver's world (and the run's summary samples) on run, from its checkpoint if
+    /// there is one.
+    /// @return true if the run was resumed from a checkpoint
+    bool StartWorld(WorldDriver<SimplePDWorld>& driver, emp::vector<double>& samples, const RunInfo& run) {
+        SimplePDWorld& world = driver.GetWorld();
+        if (checkpoint_dir.size()) {
+            std::ifstream is(RunCheckpointName(run.id), std::ios::binary);
+            if (is && world.LoadState(is) && world.GetN() == run.params->N && ReadBinary(is, samples)) {
+                driver.SetRun(run);
+                return true;
+            }
+        }
+        driver.Start(run);
+        samples.clear();
+        return false;
+    }
+
+    /// First multiple of every after epoch.
+    static size_t NextMultiple(size_t epoch, size_t every) { return (epoch / every + 1) * every; }
+
+    void Worker() {
+        WorldDriver<SimplePDWorld> driver(queue, false);
+        SimplePDWorld& world = driver.GetWorld();
+        world.SetEventDriven(event_driven);
+        if (parallel_tiles) world.SetParallel(parallel_tiles, parallel_threads);
+        std::unique_ptr<SeriesRecorder> recorder;
+        if (series_writer) recorder.reset(new SeriesRecorder(*series_writer, series_interval));
+
+        RunInfo run;
+        emp::vector<double> samples;  // Cooperator fraction at each summary epoch so far
+        const size_t summary_interval = queue.GetSummaryInterval();
+        while (TakeRun(run)) {
+            const auto start_time = std::chrono::steady_clock::now();
+
+            RunResult result;
+            result.id = run.id;
+            result.point_id = run.point_id;
+            result.seed = run.seed;
+            const PDParams& params = run.GetParams();
+            result.r = params.r;
+            result.u = params.u;
+            result.N = params.N;
+            result.E = params.E;
+
+            const bool resumed = StartWorld(driver, samples, run);
+            if (recorder) {
+                recorder->Start(run.id, resumed);
+                world.SetRecorder(recorder.get());
+            }
+            // Run up to each summary sample and checkpoint in turn.
+            while (!driver.IsDone()) {
+                size_t stop = NextMultiple(world.GetEpoch(), summary_interval);
+                if (checkpoint_every) stop = std::min(stop, NextMultiple(world.GetEpoch(), checkpoint_every));
+                driver.RunTo(stop);
+                AddWorldPerf(world);
+                if (world.GetEpoch() % summary_interval == 0 || world.GetEpoch() == driver.GetEpochs()) {
+                    samples.push_back(driver.GetSampleValue());
+                }
+                if (checkpoint_every && world.GetEpoch() % checkpoint_every == 0 && !driver.IsDone()) {
+                    if (recorder) recorder->Flush();
+                    WriteFileAtomic(RunCheckpointName(run.id), [&world, &samples](std::ostream& out) {
+                        world.SaveState(out);
+                        WriteBinary(out, samples);
+                    });
+                }
+            }
+            if (recorder) {
+                world.SetRecorder(nullptr);
+                recorder->Finish();
+            }
+
+            result.epoch = world.GetEpoch();
+            result.num_coop = world.CountCoop();
+            result.mean_fitness = world.GetMeanFitness();
+            result.stop_reason = world.IsStopped() ? world.GetStopReason() : StopReason::EPOCHS;
+            run.stop_reason = result.stop_reason;
+            queue.FillSamples(run, samples, driver.GetSampleValue());
+            result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+            FinishRun(run, samples, result);
+        }
+    }
+
+   public:
+    BatchRunner(QueueManager& _queue, size_t _threads, std::ostream& _os)
+        : queue(_queue), num_threads(_threads), os(_os) {
+        if (num_threads == 0) num_threads = 1;
+    }
+
+    size_t GetNumThreads() const { return num_threads; }
+
+    /// Saves checkpoints into dir (which must exist) as the queue drains; see class notes.
+    void SetCheckpoint(const std::string& dir, size_t every) {
+        checkpoint_dir = dir;
+        checkpoint_every = dir.empty() ? 0 : every;
+    }
+
+    /// Records every run's time series through writer, one sample every interval epochs.
+    void SetSeries(SeriesWriter* writer, size_t interval) {
+        series_writer = writer;
+        series_interval = interval;
+    }
+
+    /// Runs every world in event-driven mode; a run resumed from a checkpoint must use the same mode
+    /// as before to continue bit-identically.
+    void SetEventDriven(bool _in = true) { event_driven = _in; }
+
+    /// Runs each world's epochs on tiles per side, spread over threads threads (see
+    /// SimplePDWorld::SetParallel), for runs too large for one core; 0 tiles for the serial
+    /// update. Each worker gets threads of its own; threads 0 divides the hardware threads among
+    /// the workers (at least one each), rather than giving every worker all of them.
+    void SetParallel(size_t tiles, size_t threads) {
+        parallel_tiles = tiles;
+        parallel_threads = threads ? threads : std::max<size_t>(1, std::thread::hardware_concurrency() / num_threads);
+    }
+
+    /// Writes each point's cross-replicate summary to os as its last replicate finishes (see
+    /// QueueManager::WriteSummary); nullptr to leave summaries in the queue.
+    void SetSummary(std::ostream* os) { summary_os = os; }
+
+    /// Works on the queue in shared's directory (which must have been joined; see class notes),
+    /// checkpointing runs in progress there every checkpoint_every epochs (0 for never).
+    void SetShared(SharedQueue* _shared, size_t every) {
+        shared = _shared;
+        checkpoint_dir = shared ? shared->GetDir() : "";
+        checkpoint_every = shared ? every : 0;
+    }
+
+    /// Writes a JSON stats line to os every seconds while Run drains the queue; nullptr for none.
+    void SetStats(std::ostream* os, double seconds) {
+        stats_os = os;
+        stats_every = seconds > 0.0 ? seconds : 10.0;
+    }
+
+    /// Writes one JSON line of progress (and, built with QM_PERF=1, the counters; see class notes).
+    void WriteStats(std::ostream& os) {
+        std::ostringstream line;
+        {
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            line << "{\"elapsed_seconds\":" << std::chrono::duration<double>(std::chrono::steady_clock::now() - run_start).count()
+                 << ",\"runs_finished\":" << runs_finished << ",\"runs_queued\":" << queue.RunsRemaining();
+            if (QM_PERF) {
+                line << ",\"world\":{";
+                world_totals.WriteJSON(line);
+                line << "}";
+            }
+        }
+        if (QM_PERF) {
+            line << ",\"queue\":{";
+            queue.GetPerf().WriteJSON(line);
+            line << "}";
+        }
+        line << "}\n";
+        os << line.str() << std::flush;
+    }
+
+    /// Column names matching FormatResult (with a newline).
+    static std::string HeaderLine() {
+        return "run,point,seed,r,u,N,E,epoch,num_coop,num_defect,mean_fitness,seconds,stop\n";
+    }
+
+    /// One CSV line (with a newline) for a finished run.
+    static std::string FormatResult(const RunResult& result) {
+        std::ostringstream line;
+        line << result.id << ',' << result.point_id << ',' << result.seed << ',' << result.r << ',' << result.u << ','
+             << result.N << ',' << result.E << ',' << result.epoch << ',' << result.num_coop << ','
+             << (result.N - result.num_coop) << ',' << result.mean_fitness << ',' << result.seconds << ','
+             << StopReasonName(result.stop_reason) << '\n';
+        return line.str();
+    }
+
+    void PrintHeader() {
+        std::lock_guard<std::mutex> lock(os_mutex);
+        os << HeaderLine() << std::flush;
+    }
+
+    /// Writes one CSV line for a finished run; safe to call from any worker.
+    void PrintResult(const RunResult& result) {
+        std::lock_guard<std::mutex> lock(os_mutex);
+        os << FormatResult(result) << std::flush;
+    }
+
+    /// Runs until the queue is empty, then returns.
+    void Run() {
+        {
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            run_start = std::chrono::steady_clock::now();
+            workers_done = false;
+        }
+        std::thread stats;
+        if (stats_os) stats = std::thread(&BatchRunner::StatsLoop, this);
+        emp::vector<std::thread> workers;
+        for (size_t i = 0; i < num_threads; i++) workers.emplace_back(&BatchRunner::Worker, this);
+        for (std::thread& worker : workers) worker.join();
+        if (stats_os) {
+            {
+                std::lock_guard<std::mutex> lock(stats_mutex);
+                workers_done = true;
+            }
+            stats_cv.notify_all();
+            stats.join();
+        }
+    }
+};
+
+}  // namespace emp
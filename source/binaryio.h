@@ -0,0 +1,122 @@
+/**
+ *  @note This file is part of Empirical, https://github.com/devosoft/Empirical
+ *  @copyright Copyright (C) Michigan State University, MIT Software license; see doc/LICENSE.md
+ *  @date 2020
+ *
+ *  @file  binaryio.h
+ *  @brief Helpers for reading and writing raw binary snapshots (checkpoints) of simulation state.
+ *  @note Status:
+ */
+
+/// Values are written in the machine's own byte order; snapshots are meant to be restored on the
+/// machine (or at least the kind of machine) that wrote them.
+
+#pragma once
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+
+#include "base/vector.h"
+
+namespace emp {
+
+template <typename T>
+void WriteBinary(std::ostream& os, const T& value) {
+    static_assert(std::is_trivially_copyable<T>::value, "WriteBinary needs a plain value type");
+    os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+void WriteBinary(std::ostream& os, const emp::vector<T>& values) {
+    static_assert(std::is_trivially_copyable<T>::value, "WriteBinary needs a plain value type");
+    WriteBinary<uint64_t>(os, values.size());
+    os.write(reinterpret_cast<const char*>(values.data()), (std::streamsize)(values.size() * sizeof(T)));
+}
+
+inline void WriteBinary(std::ostream& os, const std::string& str) {
+    WriteBinary<uint64_t>(os, str.size());
+    os.write(str.data(), (std::streamsize)str.size());
+}
+
+/// @return false if the stream ran out (value is then unspecified)
+template <typename T>
+bool ReadBinary(std::istream& is, T& value) {
+    static_assert(std::is_trivially_copyable<T>::value, "ReadBinary needs a plain value type");
+    return (bool)is.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool ReadBinary(std::istream& is, emp::vector<T>& values) {
+    static_assert(std::is_trivially_copyable<T>::value, "ReadBinary needs a plain value type");
+    uint64_t size = 0;
+    if (!ReadBinary(is, size)) return false;
+    values.resize(size);
+    return (bool)is.read(reinterpret_cast<char*>(values.data()), (std::streamsize)(size * sizeof(T)));
+}
+
+inline bool ReadBinary(std::istream& is, std::string& str) {
+    uint64_t size = 0;
+    if (!ReadBinary(is, size)) return false;
+    str.resize(size);
+    return (bool)is.read(&str[0], (std::streamsize)size);
+}
+
+/// Writes all of size bytes of data to fd, however many write calls that takes.
+/// @return false if a write fails
+inline bool WriteAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        const ssize_t written = write(fd, data, size);
+        if (written == -1) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        size -= (size_t)written;
+    }
+    return true;
+}
+
+/// Flushes the directory holding filename to disk, so that a file created or renamed in it
+/// survives a power loss.
+/// @return false if the directory could not be synced
+inline bool SyncDirectory(const std::string& filename) {
+    const size_t slash = filename.rfind('/');
+    const std::string dirname = slash == std::string::npos ? "." : slash == 0 ? "/" : filename.substr(0, slash);
+    const int fd = open(dirname.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd == -1) return false;
+    const bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+/// Writes a file by writing a temporary file next to it and renaming it into place, so a crash
+/// part way through leaves the previous version intact. The temporary file is synced before the
+/// rename and the directory after it, so that after a power loss (or the crash of an NFS client)
+/// the file holds either the old contents or the new ones, never a torn mix or nothing.
+/// @param write_fun called with the stream to write to
+/// @return false if the file could not be written
+template <typename FUN_T>
+bool WriteFileAtomic(const std::string& filename, FUN_T&& write_fun) {
+    std::ostringstream os;
+    write_fun(os);
+    if (!os) return false;
+    const std::string contents = os.str();
+
+    const std::string tmp_filename = filename + ".tmp";
+    const int fd = open(tmp_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) return false;
+    const bool written = WriteAll(fd, contents.data(), contents.size()) && fsync(fd) == 0;
+    if (close(fd) != 0 || !written) return false;
+    return std::rename(tmp_filename.c_str(), filename.c_str()) == 0 && SyncDirectory(filename);
+}
+
+}  // namespace emp
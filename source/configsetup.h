@@ -4,13 +4,12 @@
 
 namespace emp {
 
-SettingConfig setup() {
+SettingConfig setup(double r = 0.02, double u = 0.175, size_t N = 6400, size_t E = 5000) {
     SettingConfig config;
-    // Testing purposes
-    config.AddSetting<double>("r_value") = {0.02};
-    config.AddSetting<double>("u_value") = {0.175};
-    config.AddSetting<size_t>("N_value") = {6400};
-    config.AddSetting<size_t>("E_value") = {5000};
+    config.AddSetting<double>("r_value") = {r};
+    config.AddSetting<double>("u_value") = {u};
+    config.AddSetting<size_t>("N_value") = {N};
+    config.AddSetting<size_t>("E_value") = {E};
 
     return config;
 }
@@ -0,0 +1,83 @@
+/**
+ *  @note This file is part of Empirical, https://github.com/devosoft/Empirical
+ *  @copyright Copyright (C) Michigan State University, MIT Software license; see doc/LICENSE.md
+ *  @date 2020
+ *
+ *  @file  counterrandom.h
+ *  @brief A counter-based random number generator whose whole state is a key and a counter.
+ *  @note Status:
+ */
+
+/// Draw i of a stream is a fixed hash of (key, i), using the SplitMix64 finalizer (Steele, Lea &
+/// Flood, 2014), so a stream can be jumped to any position in O(1), saved as two integers, and
+/// split into independent sub-streams (one per run, tile or world) without any of them depending
+/// on how many numbers the others have drawn. The interface follows the parts of emp::Random that
+/// the simulations use.
+
+#pragma once
+
+#include <cstdint>
+
+namespace emp {
+
+class CounterRandom {
+   private:
+    static constexpr uint64_t GOLDEN_GAMMA = 0x9E3779B97F4A7C15ull;
+
+    uint64_t seed;     // Seed (and stream) this generator was started from
+    uint64_t key;      // Derived from the seed; picks the stream
+    uint64_t counter;  // How many numbers have been drawn
+
+    static uint64_t Mix(uint64_t x) {
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+        return x ^ (x >> 31);
+    }
+
+   public:
+    CounterRandom(uint64_t _seed = 0, uint64_t stream = 0) { ResetSeed(_seed, stream); }
+
+    /// Value number counter of the stream for base_seed; used to give every run (or tile, or
+    /// world) its own seed from a single base seed.
+    static uint64_t DeriveSeed(uint64_t base_seed, uint64_t counter) {
+        return Mix(Mix(base_seed) + (counter + 1) * GOLDEN_GAMMA);
+    }
+
+    /// Restarts at the beginning of the stream for (seed, stream).
+    void ResetSeed(uint64_t _seed, uint64_t stream = 0) {
+        seed = _seed;
+        key = DeriveSeed(_seed, stream);
+        counter = 0;
+    }
+
+    uint64_t GetSeed() const { return seed; }
+    uint64_t GetKey() const { return key; }
+    uint64_t GetCounter() const { return counter; }
+
+    /// Restores a position saved with GetKey and GetCounter.
+    void SetState(uint64_t _key, uint64_t _counter) {
+        key = _key;
+        counter = _counter;
+    }
+
+    /// Skips ahead n draws.
+    void Discard(uint64_t n) { counter += n; }
+
+    uint64_t Get64() { return Mix(key + (++counter) * GOLDEN_GAMMA); }
+    uint32_t Get() { return (uint32_t)(Get64() >> 32); }
+
+    /// Uniform double in [0.0, 1.0)
+    double GetDouble() { return (double)(Get64() >> 11) * (1.0 / 9007199254740992.0); }
+    /// Uniform double in [0.0, max)
+    double GetDouble(double max) { return GetDouble() * max; }
+    /// Uniform double in [min, max)
+    double GetDouble(double min, double max) { return min + GetDouble() * (max - min); }
+
+    /// Uniform integer in [0, max)
+    uint32_t GetUInt(uint32_t max) { return (uint32_t)(((uint64_t)Get() * max) >> 32); }
+
+    /// True with probability p
+    bool P(double p) { return GetDouble() < p; }
+};
+
+}  // namespace emp
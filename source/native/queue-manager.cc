@@ -2,24 +2,273 @@
 //  Copyright (C) Matthew Andres Moreno, 2020.
 //  Released under MIT license; see LICENSE
 
+#include <sys/stat.h>
+
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
 
-//#include "../evolve.h"
+#include "../batchrunner.h"
+#include "../configsetup.h"
+#include "../paramsweep.h"
 #include "../queue-manager.h"
-//#include "base/vector.h"
-//#include "config/ArgManager.h"
-//#include "config/command_line.h"
-
-// This is the main function for the NATIVE version of My First Evolutionary Algorithm.
-int main() {
-    /*
-    auto args = emp::cl::ArgManager(argc, argv);
-    if (args.ProcessConfigOptions(config, std::cout, "MemicConfig.cfg", "Memic-macros.h") == false) exit(0);
-    if (args.TestUnknown() == false) exit(0);  // If there are leftover args, throw an error.
-    //emp::vector<std::string> args = emp::cl::args_to_strings(argc, argv);
-    */
-    //evolve();
-    //emp::QueueManager ex;
-    //ex.PrintConfig();
-    std::cout << "evolved, yo!" << std::endl;
-}
\ No newline at end of file
+#include "../recorder.h"
+#include "../sharedqueue.h"
+
+void PrintUsage(const std::string& name) {
+    std::cerr << "Usage: " << name << " [options]\n"
+              << "  --runs K      number of runs to queue, or replicates per point with --sweep (default 10)\n"
+              << "  --threads T   worker threads (default: all hardware threads)\n"
+              << "  --seed S      base random seed; each run's seed is derived from S and its id (default 1)\n"
+              << "  --r R         neighborhood radius (default 0.02)\n"
+              << "  --u U         cost/benefit ratio (default 0.175)\n"
+              << "  --N N         population size (default 6400)\n"
+              << "  --E E         epochs per run (default 5000)\n"
+              << "  --sweep SPEC  sweep settings, e.g. \"r_value=0.01:0.05:5; u_value=0.1,0.175; lhs=20\"\n"
+              << "                (lo:hi:count ranges or value lists; lhs=K samples K Latin-hypercube points)\n"
+              << "  --stop SPEC   end runs early, e.g. \"fixation; steady=0.01:500; budget=60\"\n"
+              << "                (all strategies equal; cooperator fraction within EPS for WINDOW epochs; seconds)\n"
+              << "  --schedule P  order to take runs in: fifo (default), sjf (cheapest first, for the first\n"
+              << "                results soonest) or ljf (most expensive first, for the shortest total time\n"
+              << "                on many threads); costs are estimated from N, r and E\n"
+              << "  --event-driven        only update organisms that can change strategy (same process in\n"
+              << "                distribution, much faster near fixation; a seed gives a different run)\n"
+              << "  --tiles K     update each world in parallel on K x K tiles of the torus (K even, each tile wider\n"
+              << "                than 4r; for N in the millions); results depend on K but not on the thread count,\n"
+              << "                and differ from the serial update's (see SimplePDWorld::SetParallel)\n"
+              << "  --tile-threads T      threads per world for --tiles (default: the hardware threads divided\n"
+              << "                among the --threads workers, at least one each; so --threads 1 gives one run\n"
+              << "                at a time all of them)\n"
+              << "  --out FILE    write per-run results to FILE instead of standard output\n"
+              << "  --summary FILE        write each point's cross-replicate summary to FILE as it completes\n"
+              << "  --summary-every K     epochs between summary samples (default 100)\n"
+              << "  --series DIR  record each run's time series to DIR/series-<run>.csv\n"
+              << "  --series-every K      epochs between time-series samples (default 10)\n"
+              << "  --series-format F     csv (default) or bin (binary columnar, see source/recorder.h)\n"
+              << "  --checkpoint DIR      save the queue and runs in progress to DIR as they go\n"
+              << "  --checkpoint-every K  epochs between checkpoints of a run in progress (default 1000)\n"
+              << "  --resume      continue the queue saved in the --checkpoint DIR instead of queueing new runs\n"
+              << "                (results are appended to the --out FILE)\n"
+              << "  --shared DIR  work on the queue in DIR together with any other processes given the same DIR;\n"
+              << "                the first one queues its runs, and the rest join (see source/sharedqueue.h).\n"
+              << "                Results and summaries go to DIR/results.csv and DIR/summary.csv, and runs\n"
+              << "                in progress are checkpointed there every --checkpoint-every epochs, so the\n"
+              << "                runs of a process that dies are taken over where they left off\n"
+              << "  --stats SECONDS       write a JSON line of progress to standard error every SECONDS; built with\n"
+              << "                PERF=1 it also has the hot-path counters and queue timers (see source/perfcounters.h)\n";
+}
+
+// Reads a whole option value as a count (digits only, and no larger than T holds).
+// @return false if value is not one
+template <typename T>
+bool ReadCount(const std::string& value, T& out) {
+    if (value.empty() || !std::isdigit((unsigned char)value[0])) return false;
+    char* end = nullptr;
+    errno = 0;
+    const unsigned long long count = std::strtoull(value.c_str(), &end, 10);
+    if (errno != 0 || *end != '\0' || count > std::numeric_limits<T>::max()) return false;
+    out = (T)count;
+    return true;
+}
+
+// Reads a whole option value as a number.
+// @return false if value is not one
+bool ReadNumber(const std::string& value, double& out) {
+    char* end = nullptr;
+    errno = 0;
+    out = std::strtod(value.c_str(), &end);
+    return value.size() && errno == 0 && *end == '\0';
+}
+
+// This is the main function for the NATIVE version of the queue manager: it queues runs and
+// drains the queue headlessly, writing one CSV line per finished run.
+int main(int argc, char* argv[]) {
+    size_t num_runs = 10;
+    size_t num_threads = std::thread::hardware_concurrency();
+    uint64_t seed = 1;
+    double r = 0.02;
+    double u = 0.175;
+    size_t N = 6400;
+    size_t E = 5000;
+    std::string out_filename;
+    std::string sweep_spec;
+    std::string stop_spec;
+    std::string schedule_name = "fifo";
+    std::string checkpoint_dir;
+    std::string shared_dir;
+    size_t checkpoint_every = 1000;
+    bool resume = false;
+    bool event_driven = false;
+    size_t tiles = 0;
+    size_t tile_threads = 0;
+    std::string series_dir;
+    size_t series_every = 10;
+    std::string series_format = "csv";
+    std::string summary_filename;
+    size_t summary_every = 100;
+    double stats_every = 0.0;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            PrintUsage(argv[0]);
+            return 0;
+        }
+        if (arg == "--resume") {
+            resume = true;
+            continue;
+        }
+        if (arg == "--event-driven") {
+            event_driven = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << std::endl;
+            PrintUsage(argv[0]);
+            return 1;
+        }
+        const std::string value = argv[++i];
+        bool ok = true;  // Whether value reads as the option's kind of value
+        if (arg == "--runs") ok = ReadCount(value, num_runs);
+        else if (arg == "--threads") ok = ReadCount(value, num_threads);
+        else if (arg == "--seed") ok = ReadCount(value, seed);
+        else if (arg == "--r") ok = ReadNumber(value, r);
+        else if (arg == "--u") ok = ReadNumber(value, u);
+        else if (arg == "--N") ok = ReadCount(value, N);
+        else if (arg == "--E") ok = ReadCount(value, E);
+        else if (arg == "--sweep") sweep_spec = value;
+        else if (arg == "--stop") stop_spec = value;
+        else if (arg == "--schedule") schedule_name = value;
+        else if (arg == "--tiles") ok = ReadCount(value, tiles);
+        else if (arg == "--tile-threads") ok = ReadCount(value, tile_threads);
+        else if (arg == "--out") out_filename = value;
+        else if (arg == "--summary") summary_filename = value;
+        else if (arg == "--summary-every") ok = ReadCount(value, summary_every);
+        else if (arg == "--series") series_dir = value;
+        else if (arg == "--series-every") ok = ReadCount(value, series_every);
+        else if (arg == "--series-format") series_format = value;
+        else if (arg == "--checkpoint") checkpoint_dir = value;
+        else if (arg == "--checkpoint-every") ok = ReadCount(value, checkpoint_every);
+        else if (arg == "--shared") shared_dir = value;
+        else if (arg == "--stats") ok = ReadNumber(value, stats_every);
+        else {
+            std::cerr << "Unknown option " << arg << std::endl;
+            PrintUsage(argv[0]);
+            return 1;
+        }
+        if (!ok) {
+            std::cerr << "Could not read \"" << value << "\" as the value of " << arg << std::endl;
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    emp::SettingConfig config = emp::setup(r, u, N, E);
+    emp::QueueManager run_list(config);
+    run_list.SetBaseSeed(seed);
+    emp::StopConditions stop;
+    if (!stop.Parse(stop_spec)) {
+        std::cerr << "Could not read stop conditions \"" << stop_spec << "\"" << std::endl;
+        return 1;
+    }
+    run_list.SetStopConditions(stop);
+    emp::SchedulePolicy policy;
+    if (!emp::ParseSchedulePolicy(schedule_name, policy)) {
+        std::cerr << "Unknown --schedule " << schedule_name << std::endl;
+        return 1;
+    }
+    run_list.SetSchedule(policy);  // Also applies to a resumed queue.
+    run_list.SetSummaryInterval(summary_every);  // A resumed queue keeps the interval it was saved with.
+    if (shared_dir.size() && (resume || checkpoint_dir.size() || out_filename.size() || summary_filename.size())) {
+        std::cerr << "--shared keeps its own checkpoints, results and summary; it cannot be combined with "
+                  << "--resume, --checkpoint, --out or --summary" << std::endl;
+        return 1;
+    }
+    if (resume) {
+        std::ifstream queue_file(checkpoint_dir + "/queue.ckpt", std::ios::binary);
+        if (checkpoint_dir.empty() || !run_list.LoadQueue(queue_file)) {
+            std::cerr << "Could not read a saved queue from --checkpoint directory \"" << checkpoint_dir << "\"" << std::endl;
+            return 1;
+        }
+    } else if (sweep_spec.empty()) {
+        run_list.AddRuns(config, num_runs);
+    } else {
+        emp::ParamSweep sweep;
+        if (!sweep.Parse(sweep_spec, emp::PDParams::SettingNames()) || num_runs == 0) {
+            std::cerr << "Could not read sweep \"" << sweep_spec << "\"";
+            if (sweep.GetParseError().size()) std::cerr << ": " << sweep.GetParseError();
+            std::cerr << std::endl;
+            return 1;
+        }
+        sweep.SetReplicates(num_runs);
+        if (sweep.IsTooLarge()) {
+            std::cerr << "Sweep \"" << sweep_spec << "\" has too many runs at --runs " << num_runs << std::endl;
+            return 1;
+        }
+        run_list.AddSweep(config, sweep);
+    }
+
+    std::unique_ptr<emp::SharedQueue> shared;
+    if (shared_dir.size()) {
+        mkdir(shared_dir.c_str(), 0755);  // Fine if it already exists.
+        shared.reset(new emp::SharedQueue(run_list, shared_dir));
+        bool created = false;
+        if (!shared->Join(emp::BatchRunner::HeaderLine(), created)) {
+            std::cerr << "Could not use the shared queue in \"" << shared_dir << "\": " << shared->GetError() << std::endl;
+            return 1;
+        }
+        if (!created) {
+            std::cerr << "Joined the queue in " << shared_dir
+                      << "; its own runs, schedule and summary interval are used instead of these" << std::endl;
+        }
+    }
+
+    std::ofstream out_file;
+    if (out_filename.size()) out_file.open(out_filename, resume ? std::ios::app : std::ios::trunc);
+    std::ostream& os = out_filename.size() ? out_file : std::cout;
+
+    emp::BatchRunner runner(run_list, num_threads, os);
+    runner.SetEventDriven(event_driven);
+    runner.SetParallel(tiles, tile_threads);
+    if (tiles && event_driven) {
+        std::cerr << "--tiles cannot be combined with --event-driven" << std::endl;
+        return 1;
+    }
+    if (checkpoint_dir.size()) {
+        mkdir(checkpoint_dir.c_str(), 0755);  // Fine if it already exists.
+        runner.SetCheckpoint(checkpoint_dir, checkpoint_every);
+    }
+    if (shared) runner.SetShared(shared.get(), checkpoint_every);
+    std::unique_ptr<emp::SeriesWriter> series_writer;
+    if (series_dir.size()) {
+        if (series_format != "csv" && series_format != "bin") {
+            std::cerr << "Unknown --series-format " << series_format << std::endl;
+            return 1;
+        }
+        mkdir(series_dir.c_str(), 0755);
+        series_writer.reset(new emp::SeriesWriter(series_dir, series_format == "csv" ? emp::SeriesWriter::Format::CSV : emp::SeriesWriter::Format::BINARY));
+        runner.SetSeries(series_writer.get(), series_every);
+    }
+
+    std::ofstream summary_file;
+    if (summary_filename.size()) {
+        summary_file.open(summary_filename, resume ? std::ios::app : std::ios::trunc);
+        if (!resume) emp::QueueManager::WriteSummaryHeader(summary_file);
+        runner.SetSummary(&summary_file);
+    }
+
+    if (stats_every > 0.0) runner.SetStats(&std::cerr, stats_every);
+
+    if (!resume && !shared) runner.PrintHeader();
+    runner.Run();
+    if (shared && shared->GetError().size()) {
+        std::cerr << "Stopped working on the shared queue: " << shared->GetError() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,136 @@
+/**
+ *  @note This file is part of Empirical, https://github.com/devosoft/Empirical
+ *  @copyright Copyright (C) Michigan State University, MIT Software license; see doc/LICENSE.md
+ *  @date 2020
+ *
+ *  @file  onlinestats.h
+ *  @brief Constant-memory, mergeable summaries of a stream of values (mean, variance, range, quantiles).
+ *  @note Status:
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <ostream>
+
+#include "base/vector.h"
+#include "binaryio.h"
+
+namespace emp {
+
+/// Running count, mean, variance (Welford's update) and range of a stream of values. Two
+/// summaries of separate streams merge into the summary of both (Chan et al.'s pairwise update).
+struct OnlineStats {
+    uint64_t count = 0;
+    double mean = 0.0;
+    double m2 = 0.0;  // Sum of squared differences from the mean
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+
+    void Add(double value) {
+        count++;
+        const double delta = value - mean;
+        mean += delta / (double)count;
+        m2 += delta * (value - mean);
+        min = std::min(min, value);
+        max = std::max(max, value);
+    }
+
+    void Merge(const OnlineStats& other) {
+        if (other.count == 0) return;
+        if (count == 0) {
+            *this = other;
+            return;
+        }
+        const double total = (double)(count + other.count);
+        const double delta = other.mean - mean;
+        mean += delta * (double)other.count / total;
+        m2 += other.m2 + delta * delta * (double)count * (double)other.count / total;
+        count += other.count;
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+    }
+
+    /// Sample variance (0 with fewer than two values)
+    double GetVariance() const { return count > 1 ? m2 / (double)(count - 1) : 0.0; }
+};
+
+/// Histogram sketch of values in [0, 1] (such as a cooperator fraction) with a fixed number of
+/// equal-width bins. Merging two sketches is exact; quantiles are accurate to within one bin.
+class FractionSketch {
+   private:
+    emp::vector<uint32_t> bins;
+    uint64_t count = 0;
+
+   public:
+    FractionSketch(size_t num_bins = 32) : bins(num_bins, 0) { ; }
+
+    void Add(double value) {
+        size_t bin = (size_t)(std::max(value, 0.0) * (double)bins.size());
+        if (bin >= bins.size()) bin = bins.size() - 1;
+        bins[bin]++;
+        count++;
+    }
+
+    void Merge(const FractionSketch& other) {
+        emp_assert(other.bins.size() == bins.size());
+        for (size_t i = 0; i < bins.size(); i++) bins[i] += other.bins[i];
+        count += other.count;
+    }
+
+    uint64_t GetCount() const { return count; }
+
+    /// Approximate q-quantile (0 <= q <= 1), interpolating linearly within the bin it falls in.
+    double Quantile(double q) const {
+        if (count == 0) return 0.0;
+        const double target = q * (double)count;
+        double seen = 0.0;
+        for (size_t i = 0; i < bins.size(); i++) {
+            if (bins[i] && seen + bins[i] >= target) {
+                const double within = (target - seen) / (double)bins[i];
+                return ((double)i + within) / (double)bins.size();
+            }
+            seen += bins[i];
+        }
+        return 1.0;
+    }
+
+    void SaveState(std::ostream& os) const {
+        WriteBinary(os, bins);
+        WriteBinary(os, count);
+    }
+    bool LoadState(std::istream& is) { return ReadBinary(is, bins) && ReadBinary(is, count); }
+};
+
+/// Everything we keep about one quantity at one sample time, across replicates.
+struct SampleSummary {
+    OnlineStats stats;
+    FractionSketch sketch;
+
+    void Add(double value) {
+        stats.Add(value);
+        sketch.Add(value);
+    }
+
+    void Merge(const SampleSummary& other) {
+        stats.Merge(other.stats);
+        sketch.Merge(other.sketch);
+    }
+
+    /// Approximate q-quantile, kept within the exact range seen.
+    double Quantile(double q) const {
+        if (stats.count == 0) return 0.0;
+        return std::min(std::max(sketch.Quantile(q), stats.min), stats.max);
+    }
+
+    void SaveState(std::ostream& os) const {
+        WriteBinary(os, stats);
+        sketch.SaveState(os);
+    }
+    bool LoadState(std::istream& is) { return ReadBinary(is, stats) && sketch.LoadState(is); }
+};
+
+}  // namespace emp
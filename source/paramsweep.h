@@ -0,0 +1,287 @@
+/**
+ *  @note This file is part of Empirical, https://github.com/devosoft/Empirical
+ *  @copyright Copyright (C) Michigan State University, MIT Software license; see doc/LICENSE.md
+ *  @date 2020
+ *
+ *  @file  paramsweep.h
+ *  @brief Describes a sweep over setting values, expanded one point at a time into queued runs.
+ *  @note Status:
+ */
+
+/// A sweep lists values for some settings (the rest come from the queue's SettingConfig). Points
+/// are either the cartesian product of every axis, or a Latin-hypercube sample of them, and each
+/// point is run a fixed number of times. Points are computed from their index on request, so a
+/// sweep never holds more than its axis definitions (plus one permutation per axis when sampling).
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <utility>
+
+#include "base/vector.h"
+#include "binaryio.h"
+#include "tools/Random.h"
+
+namespace emp {
+
+class ParamSweep {
+   private:
+    struct Axis {
+        std::string name;
+        emp::vector<double> values;  // Values to try (for a range, evenly spaced from lo to hi)
+        bool is_range;               // Latin-hypercube samples a range continuously from lo to hi
+        double lo;
+        double hi;
+    };
+
+    emp::vector<Axis> axes;
+    size_t replicates = 1;
+
+    // Latin-hypercube sampling; lhs_samples == 0 means use the full cartesian product.
+    size_t lhs_samples = 0;
+    emp::vector<emp::vector<uint32_t>> lhs_strata;  // Stratum of each sample, per axis
+    emp::vector<emp::vector<double>> lhs_offsets;   // Position of each sample within its stratum, per axis
+    int lhs_seed = 1;
+
+    std::string parse_error;  // See GetParseError
+
+    bool ParseError(const std::string& message) {
+        parse_error = message;
+        return false;
+    }
+
+    bool TooLargeError() { return ParseError("the sweep has more than " + std::to_string(MAX_POINTS) + " points"); }
+
+    /// Sets product to a * b.
+    /// @return false if that overflows
+    static bool Multiply(size_t a, size_t b, size_t& product) {
+        product = a * b;
+        return a == 0 || product / a == b;
+    }
+
+    /// @return true if the cartesian product of the axes, with one more axis of extra values,
+    /// would have more than MAX_POINTS points
+    bool GridTooLarge(size_t extra = 1) const {
+        size_t count = extra;
+        for (const Axis& axis : axes) {
+            if (!Multiply(count, axis.values.size(), count)) return true;
+        }
+        return count > MAX_POINTS;
+    }
+
+    void BuildLatinHypercube() {
+        lhs_strata.resize(axes.size());
+        lhs_offsets.resize(axes.size());
+        if (lhs_samples == 0) return;
+        emp::Random random(lhs_seed);
+        for (size_t a = 0; a < axes.size(); a++) {
+            emp::vector<uint32_t>& strata = lhs_strata[a];
+            strata.resize(lhs_samples);
+            for (size_t i = 0; i < lhs_samples; i++) strata[i] = (uint32_t)i;
+            for (size_t i = lhs_samples - 1; i > 0; i--) std::swap(strata[i], strata[random.GetUInt(i + 1)]);
+            lhs_offsets[a].resize(lhs_samples);
+            for (double& offset : lhs_offsets[a]) offset = random.GetDouble();
+        }
+    }
+
+   public:
+    ParamSweep() = default;
+
+    /// Sweeps setting name over an explicit list of values.
+    ParamSweep& AddValues(const std::string& name, const emp::vector<double>& values) {
+        emp_assert(values.size() > 0, name);
+        axes.push_back({name, values, false, values.front(), values.back()});
+        BuildLatinHypercube();
+        return *this;
+    }
+
+    /// Sweeps setting name over count evenly spaced values from lo to hi (inclusive).
+    ParamSweep& AddRange(const std::string& name, double lo, double hi, size_t count) {
+        emp_assert(count > 0, name);
+        emp::vector<double> values(count);
+        for (size_t i = 0; i < count; i++) {
+            values[i] = (count == 1) ? lo : lo + (hi - lo) * (double)i / (double)(count - 1);
+        }
+        axes.push_back({name, values, true, lo, hi});
+        BuildLatinHypercube();
+        return *this;
+    }
+
+    /// Runs every point this many times.
+    ParamSweep& SetReplicates(size_t _replicates) {
+        emp_assert(_replicates > 0);
+        replicates = _replicates;
+        return *this;
+    }
+
+    /// Instead of the cartesian product, draw this many Latin-hypercube points. Ranges are
+    /// sampled continuously; value lists are sampled by stratifying over their indices.
+    ParamSweep& UseLatinHypercube(size_t samples, int seed = 1) {
+        lhs_samples = samples;
+        lhs_seed = seed;
+        BuildLatinHypercube();
+        return *this;
+    }
+
+    size_t GetNumAxes() const { return axes.size(); }
+    const std::string& GetAxisName(size_t axis) const { return axes[axis].name; }
+    size_t GetReplicates() const { return replicates; }
+
+    /// Most points a sweep may have: the queue numbers a sweep's points with 32 bits.
+    static constexpr size_t MAX_POINTS = UINT32_MAX;
+
+    /// Number of points, if the sweep is not too large (see IsTooLarge).
+    size_t GetNumPoints() const {
+        if (lhs_samples) return lhs_samples;
+        size_t count = 1;
+        for (const Axis& axis : axes) count *= axis.values.size();
+        return count;
+    }
+
+    /// @return true if the cartesian product of the axes has more than MAX_POINTS points (even
+    /// when sampling, since the samples are stratified over it), if there are more Latin-hypercube
+    /// samples than that, or if there are more runs than a size_t counts
+    bool IsTooLarge() const {
+        size_t runs;
+        return GridTooLarge() || lhs_samples > MAX_POINTS || !Multiply(GetNumPoints(), replicates, runs);
+    }
+
+    /// @return true if some setting is an axis more than once
+    bool HasRepeatedAxis() const {
+        for (size_t a = 0; a < axes.size(); a++) {
+            for (size_t b = 0; b < a; b++) {
+                if (axes[a].name == axes[b].name) return true;
+            }
+        }
+        return false;
+    }
+
+    size_t GetNumRuns() const { return GetNumPoints() * replicates; }
+
+    /// Value of one axis at a point.
+    double GetValue(size_t point_id, size_t axis_id) const {
+        emp_assert(point_id < GetNumPoints(), point_id);
+        const Axis& axis = axes[axis_id];
+        if (lhs_samples) {
+            const double u = ((double)lhs_strata[axis_id][point_id] + lhs_offsets[axis_id][point_id]) / (double)lhs_samples;
+            if (axis.is_range) return axis.lo + u * (axis.hi - axis.lo);
+            size_t index = (size_t)(u * (double)axis.values.size());
+            return axis.values[index < axis.values.size() ? index : axis.values.size() - 1];
+        }
+        // Cartesian product: the last axis varies fastest.
+        for (size_t a = axes.size() - 1; a > axis_id; a--) point_id /= axes[a].values.size();
+        return axis.values[point_id % axis.values.size()];
+    }
+
+    /// All (setting name, value) pairs at a point.
+    emp::vector<std::pair<std::string, double>> GetPoint(size_t point_id) const {
+        emp::vector<std::pair<std::string, double>> point(axes.size());
+        for (size_t a = 0; a < axes.size(); a++) point[a] = {axes[a].name, GetValue(point_id, a)};
+        return point;
+    }
+
+    /// Writes the sweep definition (not its points) for LoadState.
+    void SaveState(std::ostream& os) const {
+        WriteBinary<uint64_t>(os, axes.size());
+        for (const Axis& axis : axes) {
+            WriteBinary(os, axis.name);
+            WriteBinary(os, axis.values);
+            WriteBinary<uint8_t>(os, axis.is_range);
+            WriteBinary(os, axis.lo);
+            WriteBinary(os, axis.hi);
+        }
+        WriteBinary<uint64_t>(os, replicates);
+        WriteBinary<uint64_t>(os, lhs_samples);
+        WriteBinary<int32_t>(os, lhs_seed);
+    }
+
+    /// Replaces this sweep with one written by SaveState; Latin-hypercube points are redrawn from
+    /// the saved seed, so they come out the same.
+    /// @return false if the stream does not hold a complete sweep
+    bool LoadState(std::istream& is) {
+        uint64_t num_axes = 0;
+        if (!ReadBinary(is, num_axes)) return false;
+        axes.resize(num_axes);
+        for (Axis& axis : axes) {
+            uint8_t is_range = 0;
+            if (!ReadBinary(is, axis.name) || !ReadBinary(is, axis.values) || !ReadBinary(is, is_range) ||
+                !ReadBinary(is, axis.lo) || !ReadBinary(is, axis.hi)) {
+                return false;
+            }
+            axis.is_range = is_range;
+        }
+        uint64_t reps = 0, samples = 0;
+        int32_t seed = 0;
+        if (!ReadBinary(is, reps) || !ReadBinary(is, samples) || !ReadBinary(is, seed)) return false;
+        replicates = reps;
+        lhs_samples = samples;
+        lhs_seed = seed;
+        BuildLatinHypercube();
+        return true;
+    }
+
+    /// Reads axes from a spec such as "r_value=0.01:0.05:5; u_value=0.1,0.175,0.2": each entry is
+    /// either name=lo:hi:count (a range) or name=v1,v2,... (a list). An entry lhs=K switches to
+    /// K Latin-hypercube samples. If names is not empty, every axis must be one of them. No setting
+    /// may be swept twice, and the sweep may not be too large (see IsTooLarge).
+    /// @return false (leaving the sweep partly filled, and the reason in GetParseError) if the
+    /// spec could not be read
+    bool Parse(const std::string& spec, const emp::vector<std::string>& names = {}) {
+        parse_error.clear();
+        std::stringstream entries(spec);
+        std::string entry;
+        while (std::getline(entries, entry, ';')) {
+            const size_t first = entry.find_first_not_of(" \t\n");
+            if (first == std::string::npos) continue;
+            entry = entry.substr(first, entry.find_last_not_of(" \t\n") + 1 - first);
+            const size_t eq_pos = entry.find('=');
+            if (eq_pos == std::string::npos || eq_pos == 0) return ParseError("expected name=values in \"" + entry + "\"");
+            const std::string name = entry.substr(0, eq_pos);
+            const std::string values = entry.substr(eq_pos + 1);
+            if (name == "lhs") {
+                const int samples = std::atoi(values.c_str());
+                if (samples < 1) return ParseError("lhs needs a sample count of at least 1");
+                UseLatinHypercube((size_t)samples, lhs_seed);
+                continue;
+            }
+            if (names.size() && std::find(names.begin(), names.end(), name) == names.end()) {
+                return ParseError("unknown setting \"" + name + "\"");
+            }
+            for (const Axis& axis : axes) {
+                if (axis.name == name) return ParseError("\"" + name + "\" is swept more than once");
+            }
+
+            char sep = values.find(':') != std::string::npos ? ':' : ',';
+            emp::vector<double> nums;
+            std::stringstream value_ss(values);
+            std::string value;
+            while (std::getline(value_ss, value, sep)) {
+                char* end = nullptr;
+                nums.push_back(std::strtod(value.c_str(), &end));
+                if (end == value.c_str()) return ParseError("could not read the values of " + name);
+            }
+            if (sep == ':') {
+                if (nums.size() != 3 || nums[2] < 1.0) return ParseError("a range of " + name + " needs lo:hi:count");
+                if (nums[2] > (double)MAX_POINTS || GridTooLarge((size_t)nums[2])) return TooLargeError();
+                AddRange(name, nums[0], nums[1], (size_t)nums[2]);
+            } else {
+                if (nums.size() == 0) return ParseError("no values for " + name);
+                if (GridTooLarge(nums.size())) return TooLargeError();
+                AddValues(name, nums);
+            }
+        }
+        return true;
+    }
+
+    /// Why the last Parse failed (empty if it did not).
+    const std::string& GetParseError() const { return parse_error; }
+};
+
+}  // namespace emp
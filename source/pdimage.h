@@ -0,0 +1,179 @@
+/**
+ *  @note This file is part of Empirical, https://github.com/devosoft/Empirical
+ *  @copyright Copyright (C) Michigan State University, MIT Software license; see doc/LICENSE.md
+ *  @date 2020
+ *
+ *  @file  pdimage.h
+ *  @brief Draws a population into an RGBA pixel buffer that the page shows with one blit.
+ *  @note Status:
+ */
+
+/// Each organism is a small disc (a fill of radius 1.5 pixels and a ring out to 2.5, as the web
+/// page used to draw them with canvas circles), blue for cooperators and red for defectors,
+/// drawn in id order so later organisms cover earlier ones. Since the positions are fixed for a
+/// run, SetPositions works out once which pixels each organism shows; Update then only repaints
+/// the pixels of organisms whose strategy bit changed (found by XOR against the bits it last
+/// drew), which gives the same image as drawing everything again.
+///
+/// Pixels are stored as 32-bit RGBA in memory order (the layout of a canvas ImageData), so the
+/// buffer can be handed to putImageData as it is.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "base/assert.h"
+#include "base/vector.h"
+
+namespace emp {
+
+/// An RGBA pixel value from its red, green and blue parts (fully opaque).
+constexpr uint32_t PixelColor(uint32_t red, uint32_t green, uint32_t blue) {
+    return red | (green << 8) | (blue << 16) | (0xFFu << 24);
+}
+
+class PDImage {
+   public:
+    static constexpr uint32_t BACKGROUND = PixelColor(0, 0, 0);       // black
+    static constexpr uint32_t HIGHLIGHT = PixelColor(255, 192, 203);  // pink
+    static constexpr uint32_t COOP_FILL = PixelColor(0, 0, 255);      // blue
+    static constexpr uint32_t COOP_LINE = PixelColor(0x88, 0x88, 0xFF);
+    static constexpr uint32_t DEFECT_FILL = PixelColor(0xFF, 0x88, 0x88);
+    static constexpr uint32_t DEFECT_LINE = PixelColor(255, 0, 0);    // red
+
+   private:
+    static constexpr double FILL_RADIUS = 1.5;
+    static constexpr double LINE_RADIUS = 2.5;
+    static constexpr uint32_t NO_OWNER = (uint32_t)-1;
+
+    size_t width;
+    size_t height;
+    emp::vector<uint32_t> pixels;      // The image
+    emp::vector<uint32_t> background;  // What shows where no organism is
+
+    // Pixels each organism shows, in compressed sparse row form: organism i shows
+    // shown_pixels[shown_start[i]] through shown_pixels[shown_start[i+1] - 1], each stored as
+    // (pixel index << 1) | 1 if it is part of the ring.
+    emp::vector<uint32_t> shown_start;
+    emp::vector<uint32_t> shown_pixels;
+
+    emp::vector<uint64_t> drawn_bits;  // Strategy bits the image shows
+    bool full_redraw = true;           // Set when every organism must be drawn again
+
+    void DrawOrganism(size_t id, bool coop) {
+        const uint32_t fill = coop ? COOP_FILL : DEFECT_FILL;
+        const uint32_t line = coop ? COOP_LINE : DEFECT_LINE;
+        for (uint32_t i = shown_start[id]; i < shown_start[id + 1]; i++) {
+            const uint32_t entry = shown_pixels[i];
+            pixels[entry >> 1] = (entry & 1) ? line : fill;
+        }
+    }
+
+   public:
+    PDImage(size_t _width = 0, size_t _height = 0) { Resize(_width, _height); }
+
+    size_t GetWidth() const { return width; }
+    size_t GetHeight() const { return height; }
+    size_t GetNumOrgs() const { return shown_start.size() ? shown_start.size() - 1 : 0; }
+    const uint32_t* GetPixels() const { return pixels.data(); }
+    uint32_t GetPixel(size_t x, size_t y) const { return pixels[y * width + x]; }
+
+    /// Changes the image size; SetPositions must be called again.
+    void Resize(size_t _width, size_t _height) {
+        width = _width;
+        height = _height;
+        pixels.assign(width * height, BACKGROUND);
+        background.assign(width * height, BACKGROUND);
+        shown_start.assign(1, 0);
+        shown_pixels.clear();
+        full_redraw = true;
+    }
+
+    /// Places the organisms of a new run; positions are in [0, 1) and scale to the image size.
+    void SetPositions(const emp::vector<float>& pos_x, const emp::vector<float>& pos_y) {
+        emp_assert(pos_x.size() == pos_y.size());
+        const size_t N = pos_x.size();
+        emp::vector<uint32_t> owner(width * height, NO_OWNER);  // Top organism at each pixel
+        emp::vector<uint8_t> ring(width * height, 0);
+
+        // Paint owners in id order, so each pixel ends up with the last organism drawn over it.
+        for (size_t id = 0; id < N; id++) {
+            const double cx = pos_x[id] * (double)width;
+            const double cy = pos_y[id] * (double)height;
+            const int x_lo = std::max(0, (int)std::floor(cx - LINE_RADIUS));
+            const int x_hi = std::min((int)width - 1, (int)std::ceil(cx + LINE_RADIUS));
+            const int y_lo = std::max(0, (int)std::floor(cy - LINE_RADIUS));
+            const int y_hi = std::min((int)height - 1, (int)std::ceil(cy + LINE_RADIUS));
+            for (int y = y_lo; y <= y_hi; y++) {
+                for (int x = x_lo; x <= x_hi; x++) {
+                    const double dx = (double)x + 0.5 - cx;
+                    const double dy = (double)y + 0.5 - cy;
+                    const double dist_sqr = dx * dx + dy * dy;
+                    if (dist_sqr > LINE_RADIUS * LINE_RADIUS) continue;
+                    const size_t pixel = (size_t)y * width + (size_t)x;
+                    owner[pixel] = (uint32_t)id;
+                    ring[pixel] = dist_sqr > FILL_RADIUS * FILL_RADIUS;
+                }
+            }
+        }
+
+        // Bucket the pixels by owner.
+        shown_start.assign(N + 1, 0);
+        for (uint32_t id : owner) {
+            if (id != NO_OWNER) shown_start[id + 1]++;
+        }
+        for (size_t id = 0; id < N; id++) shown_start[id + 1] += shown_start[id];
+        shown_pixels.resize(shown_start[N]);
+        emp::vector<uint32_t> next(shown_start.begin(), shown_start.end() - 1);
+        for (size_t pixel = 0; pixel < owner.size(); pixel++) {
+            if (owner[pixel] == NO_OWNER) continue;
+            shown_pixels[next[owner[pixel]]++] = ((uint32_t)pixel << 1) | ring[pixel];
+        }
+        full_redraw = true;
+    }
+
+    /// Shows a disc of the background in HIGHLIGHT under the organisms (radius in pixels; a
+    /// negative radius removes it).
+    void SetHighlight(double x, double y, double radius) {
+        for (size_t py = 0; py < height; py++) {
+            for (size_t px = 0; px < width; px++) {
+                const double dx = (double)px + 0.5 - x;
+                const double dy = (double)py + 0.5 - y;
+                const bool inside = radius >= 0.0 && dx * dx + dy * dy <= radius * radius;
+                background[py * width + px] = inside ? HIGHLIGHT : BACKGROUND;
+            }
+        }
+        full_redraw = true;
+    }
+
+    /// Brings the image up to date with the strategies in coop_bits (one bit per organism, as in
+    /// SimplePDWorld).
+    /// @return how many organisms were drawn
+    size_t Update(const emp::vector<uint64_t>& coop_bits) {
+        const size_t N = GetNumOrgs();
+        emp_assert(coop_bits.size() == (N + 63) / 64);
+        size_t drawn = 0;
+        if (full_redraw) {
+            std::copy(background.begin(), background.end(), pixels.begin());
+            for (size_t id = 0; id < N; id++) DrawOrganism(id, (coop_bits[id >> 6] >> (id & 63)) & 1);
+            drawn = N;
+        } else {
+            for (size_t word = 0; word < coop_bits.size(); word++) {
+                uint64_t changed = coop_bits[word] ^ drawn_bits[word];
+                while (changed) {
+                    const size_t id = word * 64 + (size_t)__builtin_ctzll(changed);
+                    DrawOrganism(id, (coop_bits[word] >> (id & 63)) & 1);
+                    drawn++;
+                    changed &= changed - 1;
+                }
+            }
+        }
+        drawn_bits = coop_bits;
+        full_redraw = false;
+        return drawn;
+    }
+};
+
+}  // namespace emp
@@ -0,0 +1,266 @@
+/**
+ *  @note This file is part of Empirical, https://github.com/devosoft/Empirical
+ *  @copyright Copyright (C) Michigan State University, MIT Software license; see doc/LICENSE.md
+ *  @date 2020
+ *
+ *  @file  pdkernels.h
+ *  @brief Whole-population loops of SimplePDWorld, with scalar, SSE4.2 and AVX2 versions picked at run time.
+ *  @note Status:
+ */
+
+/// Each kernel has a portable scalar version and, on x86-64 builds other than Emscripten,
+/// SSE4.2 and AVX2 versions compiled through target attributes (so the rest of the program does
+/// not need -mavx2). The neighbor count has no SSE4.2 version: counting needs a gather and a
+/// per-lane shift, which SSE4.2 lacks, so below AVX2 it runs the scalar loop. The best level the
+/// CPU supports is used unless SetKernelLevel asks for a lower one (see DescribeKernels for the
+/// version each kernel then runs). Every level gives bit-identical results: the fitness kernels do the same IEEE
+/// multiplies, adds and divides in the same order as the scalar code (no fused multiply-add,
+/// which would round differently).
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(__EMSCRIPTEN__) && (defined(__GNUC__) || defined(__clang__))
+#define PDKERNELS_X86 1
+#include <immintrin.h>
+#else
+#define PDKERNELS_X86 0
+#endif
+
+namespace emp {
+namespace pdkernels {
+
+enum class KernelLevel { SCALAR = 0, SSE42 = 1, AVX2 = 2 };
+
+inline const char* KernelLevelName(KernelLevel level) {
+    switch (level) {
+        case KernelLevel::AVX2: return "avx2";
+        case KernelLevel::SSE42: return "sse4.2";
+        default: return "scalar";
+    }
+}
+
+/// Best level this CPU supports.
+inline KernelLevel DetectKernelLevel() {
+#if PDKERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return KernelLevel::AVX2;
+    if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt")) return KernelLevel::SSE42;
+#endif
+    return KernelLevel::SCALAR;
+}
+
+inline KernelLevel& ActiveLevel() {
+    static KernelLevel level = DetectKernelLevel();
+    return level;
+}
+
+inline KernelLevel GetKernelLevel() { return ActiveLevel(); }
+
+/// Uses level (or the best supported level below it) from now on; mainly for tests and benchmarks.
+/// Not safe to call while kernels are running on other threads.
+inline void SetKernelLevel(KernelLevel level) {
+    const KernelLevel best = DetectKernelLevel();
+    ActiveLevel() = (int)level < (int)best ? level : best;
+}
+
+/// Version each kernel runs at the active level, e.g. "popcount=sse4.2 neighbors=scalar fitness=sse4.2".
+inline std::string DescribeKernels() {
+    const char* level = KernelLevelName(GetKernelLevel());
+    const char* neighbors = KernelLevelName(GetKernelLevel() == KernelLevel::AVX2 ? KernelLevel::AVX2 : KernelLevel::SCALAR);
+    return std::string("popcount=") + level + " neighbors=" + neighbors + " fitness=" + level;
+}
+
+/// Payoffs of one organism: C_value per cooperating and D_value per defecting neighbor.
+struct Payoffs {
+    double CC, CD, DC, DD;
+};
+
+// ---------------------------------------------------------------------------------------------
+// Scalar versions (the reference every other level must match)
+
+inline size_t PopcountScalar(const uint64_t* words, size_t num_words) {
+    size_t count = 0;
+    for (size_t i = 0; i < num_words; i++) count += (size_t)__builtin_popcountll(words[i]);
+    return count;
+}
+
+inline void CountCoopNeighborsScalar(const uint64_t* start, const uint32_t* ids, const uint64_t* bits,
+                                     uint32_t* out, size_t N) {
+    for (size_t id = 0; id < N; id++) {
+        uint32_t count = 0;
+        for (uint64_t i = start[id]; i < start[id + 1]; i++) count += (uint32_t)((bits[ids[i] >> 6] >> (ids[i] & 63)) & 1);
+        out[id] = count;
+    }
+}
+
+inline void ComputeFitnessScalar(const uint32_t* coop_nbrs, const uint64_t* start, const uint64_t* bits,
+                                 const Payoffs& pay, bool use_ave, double* fitness, size_t first, size_t N) {
+    for (size_t id = first; id < N; id++) {
+        const uint32_t C_count = coop_nbrs[id];
+        const uint32_t D_count = (uint32_t)(start[id + 1] - start[id]) - C_count;
+        const bool coop = (bits[id >> 6] >> (id & 63)) & 1;
+        const double C_value = coop ? pay.CC : pay.DC;
+        const double D_value = coop ? pay.CD : pay.DD;
+        double total_C = C_value * (double)C_count;
+        double total_D = D_value * (double)D_count;
+        double new_fitness = total_C + total_D;
+        if (use_ave && C_count + D_count > 0) new_fitness /= (double)(C_count + D_count);
+        fitness[id] = new_fitness;
+    }
+}
+
+#if PDKERNELS_X86
+
+// ---------------------------------------------------------------------------------------------
+// SSE4.2 versions: hardware popcount, and fitness two organisms at a time (no neighbor count).
+
+__attribute__((target("sse4.2,popcnt"))) inline size_t PopcountSSE42(const uint64_t* words, size_t num_words) {
+    size_t count = 0;
+    for (size_t i = 0; i < num_words; i++) count += (size_t)_mm_popcnt_u64(words[i]);
+    return count;
+}
+
+__attribute__((target("sse4.2"))) inline void ComputeFitnessSSE42(const uint32_t* coop_nbrs, const uint64_t* start,
+                                                                  const uint64_t* bits, const Payoffs& pay, bool use_ave,
+                                                                  double* fitness, size_t N) {
+    const __m128d CC = _mm_set1_pd(pay.CC), CD = _mm_set1_pd(pay.CD);
+    const __m128d DC = _mm_set1_pd(pay.DC), DD = _mm_set1_pd(pay.DD);
+    const __m128d one = _mm_set1_pd(1.0);
+    size_t id = 0;
+    for (; id + 2 <= N; id += 2) {
+        const double C0 = coop_nbrs[id], C1 = coop_nbrs[id + 1];
+        const double deg0 = (double)(start[id + 1] - start[id]), deg1 = (double)(start[id + 2] - start[id + 1]);
+        const __m128d C = _mm_set_pd(C1, C0);
+        const __m128d deg = _mm_set_pd(deg1, deg0);
+        const __m128d D = _mm_sub_pd(deg, C);  // Exact: small integers
+
+        const uint64_t pair = (bits[id >> 6] >> (id & 63)) & 3;
+        const __m128i lanes = _mm_set_epi64x(2, 1);
+        const __m128d coop = _mm_castsi128_pd(_mm_cmpeq_epi64(_mm_and_si128(_mm_set1_epi64x((long long)pair), lanes), lanes));
+        const __m128d C_value = _mm_blendv_pd(DC, CC, coop);
+        const __m128d D_value = _mm_blendv_pd(DD, CD, coop);
+
+        __m128d fit = _mm_add_pd(_mm_mul_pd(C_value, C), _mm_mul_pd(D_value, D));
+        if (use_ave) fit = _mm_div_pd(fit, _mm_max_pd(deg, one));  // A zero-degree payoff stays zero.
+        _mm_storeu_pd(fitness + id, fit);
+    }
+    ComputeFitnessScalar(coop_nbrs, start, bits, pay, use_ave, fitness, id, N);
+}
+
+// ---------------------------------------------------------------------------------------------
+// AVX2 versions: nibble-table popcount, gathered neighbor bits, fitness four organisms at a time.
+
+__attribute__((target("avx2"))) inline size_t PopcountAVX2(const uint64_t* words, size_t num_words) {
+    const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                           0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low_mask = _mm256_set1_epi8(0x0f);
+    __m256i total = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 4 <= num_words; i += 4) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + i));
+        const __m256i lo = _mm256_shuffle_epi8(table, _mm256_and_si256(v, low_mask));
+        const __m256i hi = _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask));
+        total = _mm256_add_epi64(total, _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256()));
+    }
+    size_t count = (size_t)_mm256_extract_epi64(total, 0) + (size_t)_mm256_extract_epi64(total, 1) +
+                   (size_t)_mm256_extract_epi64(total, 2) + (size_t)_mm256_extract_epi64(total, 3);
+    return count + PopcountScalar(words + i, num_words - i);
+}
+
+__attribute__((target("avx2"))) inline void CountCoopNeighborsAVX2(const uint64_t* start, const uint32_t* ids,
+                                                                   const uint64_t* bits, uint32_t* out, size_t N) {
+    // Read the bitset as 32-bit words (little endian): organism n is bit n & 31 of word n >> 5.
+    const int* words = reinterpret_cast<const int*>(bits);
+    const __m256i bit_mask = _mm256_set1_epi32(31);
+    const __m256i one = _mm256_set1_epi32(1);
+    for (size_t id = 0; id < N; id++) {
+        uint64_t i = start[id];
+        const uint64_t end = start[id + 1];
+        __m256i counts = _mm256_setzero_si256();
+        for (; i + 8 <= end; i += 8) {
+            const __m256i nbrs = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ids + i));
+            const __m256i word = _mm256_i32gather_epi32(words, _mm256_srli_epi32(nbrs, 5), 4);
+            const __m256i bit = _mm256_and_si256(_mm256_srlv_epi32(word, _mm256_and_si256(nbrs, bit_mask)), one);
+            counts = _mm256_add_epi32(counts, bit);
+        }
+        __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(counts), _mm256_extracti128_si256(counts, 1));
+        sum = _mm_hadd_epi32(sum, sum);
+        sum = _mm_hadd_epi32(sum, sum);
+        uint32_t count = (uint32_t)_mm_cvtsi128_si32(sum);
+        for (; i < end; i++) count += (uint32_t)((bits[ids[i] >> 6] >> (ids[i] & 63)) & 1);
+        out[id] = count;
+    }
+}
+
+__attribute__((target("avx2"))) inline void ComputeFitnessAVX2(const uint32_t* coop_nbrs, const uint64_t* start,
+                                                               const uint64_t* bits, const Payoffs& pay, bool use_ave,
+                                                               double* fitness, size_t N) {
+    const __m256d CC = _mm256_set1_pd(pay.CC), CD = _mm256_set1_pd(pay.CD);
+    const __m256d DC = _mm256_set1_pd(pay.DC), DD = _mm256_set1_pd(pay.DD);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256i lanes = _mm256_set_epi64x(8, 4, 2, 1);
+    const __m256i low_halves = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+    size_t id = 0;
+    for (; id + 4 <= N; id += 4) {
+        const __m128i C32 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(coop_nbrs + id));
+        // Degrees are small, so the low halves of the 64-bit offset differences hold them.
+        const __m256i deg64 = _mm256_sub_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(start + id + 1)),
+                                               _mm256_loadu_si256(reinterpret_cast<const __m256i*>(start + id)));
+        const __m128i deg32 = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(deg64, low_halves));
+        const __m256d C = _mm256_cvtepi32_pd(C32);
+        const __m256d deg = _mm256_cvtepi32_pd(deg32);
+        const __m256d D = _mm256_sub_pd(deg, C);  // Exact: small integers
+
+        // Four consecutive organisms (id is a multiple of four) share one bitset word.
+        const uint64_t nibble = (bits[id >> 6] >> (id & 63)) & 15;
+        const __m256d coop = _mm256_castsi256_pd(
+            _mm256_cmpeq_epi64(_mm256_and_si256(_mm256_set1_epi64x((long long)nibble), lanes), lanes));
+        const __m256d C_value = _mm256_blendv_pd(DC, CC, coop);
+        const __m256d D_value = _mm256_blendv_pd(DD, CD, coop);
+
+        __m256d fit = _mm256_add_pd(_mm256_mul_pd(C_value, C), _mm256_mul_pd(D_value, D));
+        if (use_ave) fit = _mm256_div_pd(fit, _mm256_max_pd(deg, one));  // A zero-degree payoff stays zero.
+        _mm256_storeu_pd(fitness + id, fit);
+    }
+    ComputeFitnessScalar(coop_nbrs, start, bits, pay, use_ave, fitness, id, N);
+}
+
+#endif  // PDKERNELS_X86
+
+// ---------------------------------------------------------------------------------------------
+// Dispatch
+
+/// Number of set bits in words[0 .. num_words).
+inline size_t Popcount(const uint64_t* words, size_t num_words) {
+#if PDKERNELS_X86
+    if (GetKernelLevel() == KernelLevel::AVX2) return PopcountAVX2(words, num_words);
+    if (GetKernelLevel() == KernelLevel::SSE42) return PopcountSSE42(words, num_words);
+#endif
+    return PopcountScalar(words, num_words);
+}
+
+/// For each of N organisms, counts neighbors (CSR lists start/ids) whose bit is set in bits.
+inline void CountCoopNeighbors(const uint64_t* start, const uint32_t* ids, const uint64_t* bits, uint32_t* out, size_t N) {
+#if PDKERNELS_X86
+    if (GetKernelLevel() == KernelLevel::AVX2) return CountCoopNeighborsAVX2(start, ids, bits, out, N);
+#endif
+    CountCoopNeighborsScalar(start, ids, bits, out, N);
+}
+
+/// Computes the payoff of each of N organisms from its count of cooperating neighbors, its degree
+/// and its own strategy bit, exactly as SimplePDWorld::CalcFitness does.
+inline void ComputeFitness(const uint32_t* coop_nbrs, const uint64_t* start, const uint64_t* bits, const Payoffs& pay,
+                           bool use_ave, double* fitness, size_t N) {
+#if PDKERNELS_X86
+    if (GetKernelLevel() == KernelLevel::AVX2) return ComputeFitnessAVX2(coop_nbrs, start, bits, pay, use_ave, fitness, N);
+    if (GetKernelLevel() == KernelLevel::SSE42) return ComputeFitnessSSE42(coop_nbrs, start, bits, pay, use_ave, fitness, N);
+#endif
+    ComputeFitnessScalar(coop_nbrs, start, bits, pay, use_ave, fitness, 0, N);
+}
+
+}  // namespace pdkernels
+}  // namespace emp
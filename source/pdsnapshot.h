@@ -0,0 +1,123 @@
+/**
+ *  @note This file is part of Empirical, https://github.com/devosoft/Empirical
+ *  @copyright Copyright (C) Michigan State University, MIT Software license; see doc/LICENSE.md
+ *  @date 2020
+ *
+ *  @file  pdsnapshot.h
+ *  @brief Compact messages between the web page and the Web Worker that runs its SimplePDWorld.
+ *  @note Status:
+ */
+
+/// The web version runs its world in a Web Worker (see source/web/queue-manager-worker.cc) so
+/// the page stays responsive. The page asks the worker to start a run (PDStartRequest) or to
+/// advance it (PDStepRequest), and the worker answers each request with a PDSnapshot: the epoch,
+/// counts and strategy bits the page needs to draw, packed into one buffer. Positions never
+/// change during a run, so only the answer to a start request carries them.
+///
+/// Every request carries the token of the run it belongs to; a page that has moved on (say, to
+/// a freshly randomized world) drops answers that still arrive for an older token.
+
+#pragma once
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+#include "base/vector.h"
+#include "binaryio.h"
+#include "simplepdworld.h"
+
+namespace emp {
+
+/// Set up a new run in the worker.
+struct PDStartRequest {
+    uint64_t token = 0;  // Identifies the run from now on
+    PDParams params;
+    uint64_t seed = 0;
+};
+
+/// Run the current run on: up to max_epochs epochs, but no further than epoch limit and no
+/// longer than max_seconds (at least one epoch is always run, unless the run has stopped or
+/// reached limit).
+struct PDStepRequest {
+    uint64_t token = 0;
+    uint64_t max_epochs = 1;
+    uint64_t limit = (uint64_t)-1;
+    double max_seconds = 0.0;
+};
+
+class PDSnapshot {
+   private:
+    static constexpr uint32_t MAGIC = 0x32534450;  // "PDS2"
+
+   public:
+    uint64_t token = 0;  // Run this is a snapshot of (see PDStartRequest)
+    uint64_t epoch = 0;
+    uint64_t num_coop = 0;
+    uint64_t N = 0;
+    double r = 0.0;
+    StopReason stop_reason = StopReason::NONE;
+    emp::vector<uint64_t> coop_bits;        // Strategy of each organism (as in SimplePDWorld)
+    emp::vector<float> pos_x, pos_y;        // Positions, or empty if this snapshot has none
+    WorldPerf perf;                         // The world's counters so far this run (see perfcounters.h)
+
+    // Read as a SimplePDWorld is (see WorldReporter in worlddriver.h)
+    size_t GetEpoch() const { return (size_t)epoch; }
+    size_t GetN() const { return (size_t)N; }
+    size_t CountCoop() const { return (size_t)num_coop; }
+    StopReason GetStopReason() const { return stop_reason; }
+
+    bool HasPositions() const { return pos_x.size() == N; }
+    bool IsCoop(size_t id) const { return (coop_bits[id >> 6] >> (id & 63)) & 1; }
+
+    /// Takes the state of world, with its positions if with_positions is set.
+    void Capture(const SimplePDWorld& world, bool with_positions) {
+        epoch = world.GetEpoch();
+        num_coop = world.CountCoop();
+        N = world.GetN();
+        r = world.GetR();
+        stop_reason = world.GetStopReason();
+        coop_bits = world.coop_bits;
+        perf = world.GetPerf();
+        pos_x.clear();
+        pos_y.clear();
+        if (!with_positions) return;
+        pos_x.resize(N);
+        pos_y.resize(N);
+        for (size_t id = 0; id < N; id++) {
+            pos_x[id] = (float)world.GetX(id);
+            pos_y[id] = (float)world.GetY(id);
+        }
+    }
+
+    /// Packs the snapshot into out (replacing its contents).
+    void Write(std::string& out) const {
+        std::ostringstream os(std::ios::binary);
+        WriteBinary(os, MAGIC);
+        WriteBinary(os, token);
+        WriteBinary(os, epoch);
+        WriteBinary(os, num_coop);
+        WriteBinary(os, N);
+        WriteBinary(os, r);
+        WriteBinary(os, stop_reason);
+        WriteBinary(os, coop_bits);
+        WriteBinary(os, pos_x);
+        WriteBinary(os, pos_y);
+        WriteBinary(os, perf);
+        out = os.str();
+    }
+
+    /// Unpacks a buffer made by Write.
+    /// @return false if the buffer is not a complete snapshot
+    bool Read(const char* data, size_t size) {
+        std::istringstream is(std::string(data, size), std::ios::binary);
+        uint32_t magic = 0;
+        if (!ReadBinary(is, magic) || magic != MAGIC) return false;
+        return ReadBinary(is, token) && ReadBinary(is, epoch) && ReadBinary(is, num_coop) &&
+               ReadBinary(is, N) && ReadBinary(is, r) && ReadBinary(is, stop_reason) &&
+               ReadBinary(is, coop_bits) && ReadBinary(is, pos_x) && ReadBinary(is, pos_y) &&
+               ReadBinary(is, perf) && coop_bits.size() == (N + 63) / 64;
+    }
+};
+
+}  // namespace emp
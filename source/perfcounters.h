@@ -0,0 +1,103 @@
+/**
+ *  @note This file is part of Empirical, https://github.com/devosoft/Empirical
+ *  @copyright Copyright (C) Michigan State University, MIT Software license; see doc/LICENSE.md
+ *  @date 2020
+ *
+ *  @file  perfcounters.h
+ *  @brief Hot-path counters and timers for SimplePDWorld and QueueManager, compiled in with QM_PERF=1.
+ *  @note Status:
+ */
+
+/// Build with -DQM_PERF=1 (make PERF=1) to turn the counters on. Otherwise QM_PERF_COUNT and
+/// QM_PERF_TIME compile to nothing, and the counter structs, which always exist so that code
+/// reading them builds either way, just stay at zero.
+///
+/// Counters are plain integers owned by one thread (each world, or the queue under its mutex);
+/// readers add them up at quiet points (see SimplePDWorld::TakePerf).
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+#ifndef QM_PERF
+#define QM_PERF 0
+#endif
+
+namespace emp {
+
+/// Counters of one SimplePDWorld (since its last Setup or TakePerf).
+struct WorldPerf {
+    uint64_t repro_calls = 0;         // Repro calls done (an event-driven epoch skips some)
+    uint64_t flips = 0;               // Strategy changes
+    uint64_t calc_fitness_calls = 0;
+    uint64_t neighbors_scanned = 0;   // Neighbor list entries read by Repro and the updates it makes
+    uint64_t epochs = 0;
+    uint64_t run_ns = 0;              // Time spent in Run
+    uint64_t setup_ns = 0;            // Time spent in Setup
+
+    WorldPerf& operator+=(const WorldPerf& other) {
+        repro_calls += other.repro_calls;
+        flips += other.flips;
+        calc_fitness_calls += other.calc_fitness_calls;
+        neighbors_scanned += other.neighbors_scanned;
+        epochs += other.epochs;
+        run_ns += other.run_ns;
+        setup_ns += other.setup_ns;
+        return *this;
+    }
+
+    /// Writes the counters as JSON object members (no braces), e.g. "repro_calls":12,...
+    void WriteJSON(std::ostream& os) const {
+        os << "\"repro_calls\":" << repro_calls << ",\"flips\":" << flips << ",\"calc_fitness_calls\":"
+           << calc_fitness_calls << ",\"neighbors_scanned\":" << neighbors_scanned << ",\"epochs\":" << epochs
+           << ",\"run_seconds\":" << (double)run_ns * 1e-9 << ",\"setup_seconds\":" << (double)setup_ns * 1e-9;
+    }
+};
+
+/// Timers of one QueueManager.
+struct QueuePerf {
+    uint64_t runs_taken = 0;
+    uint64_t wait_ns = 0;       // Total time taken runs spent queued (since being added, or loaded)
+    uint64_t max_wait_ns = 0;
+    uint64_t runs_timed = 0;    // Runs reported through QueueManager::AddRunTime
+    uint64_t run_ns = 0;        // Their total wall-clock time
+    uint64_t max_run_ns = 0;
+    uint64_t table_updates = 0; // DivRedrawTable calls
+    uint64_t table_ns = 0;      // Time spent in them
+
+    /// Writes the timers as JSON object members (no braces).
+    void WriteJSON(std::ostream& os) const {
+        os << "\"runs_taken\":" << runs_taken << ",\"wait_seconds\":" << (double)wait_ns * 1e-9
+           << ",\"max_wait_seconds\":" << (double)max_wait_ns * 1e-9 << ",\"runs_timed\":" << runs_timed
+           << ",\"run_seconds\":" << (double)run_ns * 1e-9 << ",\"max_run_seconds\":" << (double)max_run_ns * 1e-9
+           << ",\"table_updates\":" << table_updates << ",\"table_seconds\":" << (double)table_ns * 1e-9;
+    }
+};
+
+/// Nanoseconds between two steady_clock readings.
+inline uint64_t PerfNanoseconds(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+}
+
+/// Adds the time until it goes out of scope to a counter of nanoseconds.
+class PerfTimer {
+   private:
+    uint64_t& target;
+    std::chrono::steady_clock::time_point start;
+
+   public:
+    PerfTimer(uint64_t& _target) : target(_target), start(std::chrono::steady_clock::now()) { ; }
+    ~PerfTimer() { target += PerfNanoseconds(start, std::chrono::steady_clock::now()); }
+};
+
+}  // namespace emp
+
+#if QM_PERF
+#define QM_PERF_COUNT(counter, amount) ((counter) += (amount))
+#define QM_PERF_TIME(target) emp::PerfTimer qm_perf_timer(target)  // Until the end of the scope
+#else
+#define QM_PERF_COUNT(counter, amount) ((void)0)
+#define QM_PERF_TIME(target) ((void)0)
+#endif
@@ -16,16 +16,29 @@
 
 #pragma once
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <deque>
 #include <functional>
-#include <queue>
+#include <map>
+#include <memory>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <set>
 #include <string>
 #include <unordered_map>
 #include <utility>
 
 #include "base/vector.h"
+#include "binaryio.h"
 #include "config/SettingConfig.h"
+#include "onlinestats.h"
+#include "paramsweep.h"
+#include "perfcounters.h"
+#include "counterrandom.h"
 #include "simplepdworld.h"
-#include "tools/Random.h"
 #include "tools/math.h"
 #include "web/Div.h"
 #include "web/web.h"
@@ -34,68 +47,984 @@ namespace emp {
 
 /// Information of each element within queue. This info represents the information required for each run to be processed.
 struct RunInfo {
-    SettingConfig runinfo_config;
+    std::shared_ptr<const PDParams> params;  // Shared by every replicate of the same point
 
     size_t id;
+    size_t point_id;    // Runs with the same point_id are replicates of one set of parameters
+    size_t replicates;  // How many runs share this point_id
+    uint64_t seed;      // Derived from the queue's base seed and id alone, so any run can be replayed
 
     // PD world
     size_t cur_epoch;
-    size_t num_coop;
-    std::string num_defect;
+    StopReason stop_reason = StopReason::NONE;  // Set once the run has finished
+    // When the run was queued (for QueuePerf; saved as wall-clock time, see SaveRun)
+    std::chrono::steady_clock::time_point queued_at = std::chrono::steady_clock::now();
 
-    RunInfo(SettingConfig _config, size_t _id)
-        : runinfo_config(_config), id(_id), cur_epoch(0), num_coop(0), num_defect("") { ; }
+    RunInfo() : id(0), point_id(0), replicates(1), seed(0), cur_epoch(0) { ; }
+    RunInfo(std::shared_ptr<const PDParams> _params, size_t _id, size_t _point_id, size_t _replicates, uint64_t _seed)
+        : params(_params), id(_id), point_id(_point_id), replicates(_replicates), seed(_seed), cur_epoch(0) { ; }
+
+    const PDParams& GetParams() const { return *params; }
+};
+
+/// Cooperator fraction of one parameter point across its replicates, at each sample epoch (see
+/// QueueManager::GetSampleEpoch). Each finished run adds one value per sample epoch, so the memory
+/// used depends on E and the summary interval but not on the number of replicates.
+struct PointSummary {
+    std::shared_ptr<const PDParams> params;
+    size_t runs_expected = 0;
+    size_t runs_done = 0;
+    emp::vector<SampleSummary> samples;  // One per sample epoch
+
+    bool IsComplete() const { return runs_done >= runs_expected; }
 };
 
+/// Order in which queued runs are taken, among runs of the same priority (see QueueManager::SetSchedule).
+/// Costs are estimated with PDParams::EstimateCost.
+enum class SchedulePolicy : uint8_t {
+    FIFO,  // In the order they were queued
+    SJF,   // Cheapest first: the first results come soonest
+    LJF    // Most expensive first: packs a pool of workers best, for the shortest total time
+};
+
+inline const char* SchedulePolicyName(SchedulePolicy policy) {
+    switch (policy) {
+        case SchedulePolicy::SJF: return "sjf";
+        case SchedulePolicy::LJF: return "ljf";
+        default: return "fifo";
+    }
+}
+
+/// Reads a policy name (fifo, sjf or ljf).
+/// @return false if name is not a policy
+inline bool ParseSchedulePolicy(const std::string& name, SchedulePolicy& policy) {
+    if (name == "fifo") policy = SchedulePolicy::FIFO;
+    else if (name == "sjf") policy = SchedulePolicy::SJF;
+    else if (name == "ljf") policy = SchedulePolicy::LJF;
+    else return false;
+    return true;
+}
+
 /// Primary class that establishes queue for runs and processes them accordingly
+/// AddRun, PopRun, IsEmpty and RunsRemaining may be called from several threads at once;
+/// FrontRun and the Div* functions are for the single-threaded web driver.
+///
+/// Queued runs are taken highest priority first, and among runs of equal priority in the order
+/// set by the SchedulePolicy. A run is scheduled once it is expanded to the front: from then on
+/// (and for runs restored in flight by LoadQueue) it keeps its place.
 class QueueManager {
    private:
+    /// Points of a sweep in the order SJF or LJF takes them, shared by the batches it was split
+    /// into. Costs one pair of 32-bit entries per point, where a batch per point would cost a
+    /// RunBatch and a schedule entry each.
+    struct PointWalk {
+        SchedulePolicy policy;           // Policy the points are sorted for
+        emp::vector<uint32_t> points;    // Point offsets (within the sweep), cheapest or costliest first
+        size_t min_point = 0;            // Smallest offset in points
+        emp::vector<uint32_t> position;  // Index in points of each offset from min_point (NOT_WALKED if absent)
+
+        static constexpr uint32_t NOT_WALKED = (uint32_t)-1;
+
+        void BuildPositions() {
+            min_point = points.size() ? *std::min_element(points.begin(), points.end()) : 0;
+            const size_t max_point = points.size() ? *std::max_element(points.begin(), points.end()) : 0;
+            position.assign(points.size() ? max_point - min_point + 1 : 0, NOT_WALKED);
+            for (size_t i = 0; i < points.size(); i++) position[points[i] - min_point] = (uint32_t)i;
+        }
+    };
+
+    /// A group of queued runs that are only turned into RunInfo entries as they reach the front.
+    /// Its runs are numbered in the order it gives them out, and runs next_run up to num_runs - 1
+    /// are still queued: run k is replicate k % replicates of the (k / replicates)-th point of the
+    /// walk (or simply run first_id + k without one). Cancelling or reprioritizing a run splits it
+    /// off into a batch of its own.
+    struct RunBatch {
+        std::shared_ptr<const PDParams> params;   // Parameters of the point being expanded
+        std::shared_ptr<const ParamSweep> sweep;  // nullptr for plain replicates of params
+        std::shared_ptr<const PointWalk> walk;    // nullptr to give runs out in id order
+        size_t first_id;
+        size_t first_point;
+        size_t replicates;  // Runs per point
+        size_t num_runs;
+        size_t next_run = 0;
+        int priority = 0;
+        uint64_t order = 0;  // When the runs were queued (batches split from one another share it)
+        double rank = 0.0;   // Position among equal priorities under the schedule policy
+        std::chrono::steady_clock::time_point queued_at = std::chrono::steady_clock::now();  // Given to its runs
+    };
+
+    /// A batch's place in the schedule: higher priority first, then lower rank, then queue order.
+    struct ScheduleEntry {
+        int priority;
+        double rank;
+        uint64_t order;
+        size_t batch;  // Key of the batch in batches
+
+        bool operator<(const ScheduleEntry& other) const {
+            if (priority != other.priority) return priority > other.priority;
+            if (rank != other.rank) return rank < other.rank;
+            if (order != other.order) return order < other.order;
+            return batch < other.batch;
+        }
+    };
+
     SettingConfig queue_config;
-    std::queue<RunInfo> runs;
+    PDParams queue_params;          // queue_config, read once
+    std::deque<RunInfo> runs;       // Runs already expanded from their batch
+    std::map<size_t, RunBatch> batches;  // Runs still to be expanded, by the first id each batch held
+    std::set<ScheduleEntry> schedule;    // Every batch, in the order they are taken
+    size_t batched_runs = 0;        // Total runs left in batches
+    SchedulePolicy policy = SchedulePolicy::FIFO;
+    int add_priority = 0;     // Priority of runs added from now on
+    uint64_t next_order = 0;  // order to give the next batch added
+    mutable std::mutex runs_mutex;
+    size_t next_id = 0;     // id to give the next run added
+    size_t next_point = 0;  // point id to give the next set of parameters added
+    uint64_t base_seed = 1; // Every run's seed is derived from this and the run's id
+    StopConditions stop_conditions;  // Given to every run added from now on
     emp::web::Div display_div;
     std::string table_id;
-    // ordered names of dependant headers with associated column #'s
-    emp::vector<std::pair<std::string, int>> ordered_names;
-    std::unordered_map<std::string, std::function<std::string()>> dependant_headers;
-    // for SimplePDWorld
+    std::string sweep_spec;  // Sweep to queue from the web page (see ParamSweep::Parse); empty for none
+    // Metrics shown in the results table (see AddMetric), by slot: name, table column and the
+    // front run's current value.
+    struct MetricColumn {
+        std::string name;
+        size_t column = 0;
+        double value = 0.0;
+    };
+    emp::vector<MetricColumn> metrics;
+    size_t epoch_column = 0;  // Table column of the epoch
+    // Last sample of a point's summary row (see DivSummaryRow)
+    struct SummaryRow {
+        size_t point_id = 0;
+        size_t epoch = 0;
+        size_t count = 0;
+        double mean = 0.0, sd = 0.0, min = 0.0, median = 0.0, max = 0.0;
+    };
+    // Rows of the results table, in order, a block at a time: the runs queued by one click, or
+    // one point's summary. Only numbers are kept; the text of a row is made while it is shown.
+    struct TableBlock {
+        size_t first_row = 0;
+        size_t num_rows = 1;
+        size_t first_id = 0;                        // Run id of the first row
+        emp::vector<std::string> settings;          // Setting columns, before any sweep values
+        std::shared_ptr<const ParamSweep> sweep;    // Sweep whose points the runs replicate, or nullptr
+        emp::vector<size_t> axis_columns;           // Table column of each sweep axis (0 for none)
+        std::shared_ptr<const PDParams> point;      // Parameters of a summary row's point; nullptr for runs
+        SummaryRow summary;
+    };
+    emp::vector<TableBlock> table_blocks;
+    std::map<size_t, size_t> run_blocks;  // Block (in table_blocks) of each block of runs, by first run id
+    size_t table_num_rows = 0;
+    // Last progress of each run that has started or been cancelled (see DivInfoTable)
+    struct RunProgress {
+        bool started = false;
+        bool cancelled = false;
+        size_t epoch = 0;
+        StopReason stop_reason = StopReason::NONE;
+        emp::vector<double> metrics;  // Value of each metric
+        WorldPerf world_perf;
+        double wait = 0.0;
+    };
+    std::unordered_map<size_t, RunProgress> run_progress;  // By run id
+    // The results table only shows a window of table_window rows; each shown cell is a Text
+    // widget, updated only when its text changes.
+    std::unique_ptr<emp::web::Table> result_table;         // Cached handle (see DivAddTable)
+    size_t table_cols = 0;
+    emp::vector<std::string> row_cells;                    // Scratch space for the text of one row
+    emp::vector<emp::vector<emp::web::Text>> table_cells;  // Widget of each shown cell
+    emp::vector<emp::vector<std::string>> shown_cells;     // Text each shown cell has now
+    emp::web::Text table_position;                         // Which rows are shown
+    size_t table_first = 0;    // First row shown
+    size_t table_window = 25;  // Rows shown at once
+    bool table_follow = true;  // Move the window along with the run in progress
+    // Progress of the front run (see DivTableCalc)
     size_t epoch_ = 0;
-    size_t coop_ = 0;
+    double sample_ = 0.0;  // Value sampled for the summaries
+    StopReason stop_ = StopReason::NONE;
+    std::string stop_spec;  // Stop conditions typed on the web page (see StopConditions::Parse)
+    std::string schedule_id;  // Run id typed on the web page (see DivAddScheduleArea)
+    emp::vector<double> front_samples;  // Cooperator fractions of the front run so far (web driver)
+
+    // Timers (see perfcounters.h). Workers update them under perf_mutex; the table timer is only
+    // touched by the web driver. perf_column is 0 unless built with QM_PERF=1.
+    QueuePerf perf;
+    mutable std::mutex perf_mutex;
+    size_t perf_column = 0;
+    WorldPerf world_perf_;    // Counters of the world running the front run (web driver)
+    size_t perf_front_id = (size_t)-1;  // Front run when DivTableCalc last saw one
+    std::chrono::steady_clock::time_point front_start;  // When it became the front run
+    double front_wait = 0.0;  // How long it had been queued by then, in seconds
+
+    // Cross-replicate summaries, by point id
+    std::map<size_t, PointSummary> summaries;
+    mutable std::mutex summary_mutex;  // Taken after runs_mutex when both are needed
+    size_t summary_interval = 100;     // Epochs between summary samples
+
+    // The functions below, up to ExpandFront, need runs_mutex to be held.
+
+    /// Parameters of a point of batch's sweep (every axis is set, so any point's parameters will
+    /// do as a base).
+    static PDParams PointParams(const RunBatch& batch, size_t point_offset) {
+        PDParams point_params = *batch.params;
+        if (!batch.sweep) return point_params;
+        for (size_t axis = 0; axis < batch.sweep->GetNumAxes(); axis++) {
+            const bool known = point_params.SetValue(batch.sweep->GetAxisName(axis), batch.sweep->GetValue(point_offset, axis));
+            emp_assert(known, batch.sweep->GetAxisName(axis));  // AddSweep turns away unknown settings.
+            (void)known;
+        }
+        return point_params;
+    }
+
+    /// Checks that every axis of sweep names a PDParams setting.
+    static bool IsPDSweep(const ParamSweep& sweep) {
+        const emp::vector<std::string>& names = PDParams::SettingNames();
+        for (size_t axis = 0; axis < sweep.GetNumAxes(); axis++) {
+            if (std::find(names.begin(), names.end(), sweep.GetAxisName(axis)) == names.end()) return false;
+        }
+        return true;
+    }
+
+    /// Offset (within its sweep) of the point of batch's run k.
+    static size_t PointOffset(const RunBatch& batch, size_t k) {
+        return batch.walk ? batch.walk->points[k / batch.replicates] : k / batch.replicates;
+    }
+
+    /// Id of batch's run k.
+    static size_t RunId(const RunBatch& batch, size_t k) {
+        return batch.first_id + PointOffset(batch, k) * batch.replicates + k % batch.replicates;
+    }
+
+    /// Finds run id among the runs batch still holds.
+    /// @return false if batch does not hold it; otherwise k is its number within batch
+    static bool FindRun(const RunBatch& batch, size_t id, size_t& k) {
+        if (id < batch.first_id) return false;
+        size_t offset = id - batch.first_id;
+        if (batch.walk) {
+            const PointWalk& walk = *batch.walk;
+            const size_t point = offset / batch.replicates;
+            if (point < walk.min_point || point - walk.min_point >= walk.position.size() ||
+                walk.position[point - walk.min_point] == PointWalk::NOT_WALKED) {
+                return false;
+            }
+            offset = walk.position[point - walk.min_point] * batch.replicates + offset % batch.replicates;
+        }
+        if (offset < batch.next_run || offset >= batch.num_runs) return false;
+        k = offset;
+        return true;
+    }
+
+    /// Runs start up to end - 1 of batch, as a batch of their own.
+    static RunBatch Piece(const RunBatch& batch, size_t start, size_t end) {
+        RunBatch part = batch;
+        part.next_run = start;
+        part.num_runs = end;
+        // A piece that starts part way through a sweep point needs that point's parameters.
+        if (part.sweep && start % part.replicates != 0) {
+            part.params = std::make_shared<const PDParams>(PointParams(batch, PointOffset(batch, start)));
+        }
+        return part;
+    }
+
+    /// Replicates first up to end - 1 of one point of batch, as a batch of their own in id order.
+    static RunBatch PointPiece(const RunBatch& batch, size_t point, size_t first, size_t end) {
+        RunBatch part = batch;
+        part.walk = nullptr;
+        part.params = batch.params;
+        if (first != 0) part.params = std::make_shared<const PDParams>(PointParams(batch, point));
+        part.next_run = point * batch.replicates + first;
+        part.num_runs = point * batch.replicates + end;
+        return part;
+    }
+
+    /// Does batch (a sweep) give out its points in the order the policy wants?
+    bool InPolicyOrder(const RunBatch& batch) const {
+        if (policy == SchedulePolicy::FIFO) return !batch.walk;
+        if (batch.walk) return batch.walk->policy == policy;
+        return batch.next_run / batch.replicates == (batch.num_runs - 1) / batch.replicates;  // One point
+    }
+
+    /// Replaces the sweep batch with key by batches that give its runs out in the order the
+    /// policy wants: the replicates left of a point already started and of a last point only
+    /// partly held stay batches of their own, and the whole points between them become one
+    /// batch walking them in cost order (SJF, LJF), or a batch per stretch of consecutive ids
+    /// (FIFO). Only the walk is ever sorted; no point gets a batch of its own.
+    void Rewalk(size_t key) {
+        const RunBatch whole = batches[key];
+        batches.erase(key);
+        const size_t reps = whole.replicates;
+        emp::vector<RunBatch> parts;
+
+        size_t start = whole.next_run, end = whole.num_runs;
+        if (start % reps) {  // Point already started
+            const size_t stop = std::min(end, (start / reps + 1) * reps);
+            parts.push_back(PointPiece(whole, PointOffset(whole, start), start % reps, stop - (start / reps) * reps));
+            start = stop;
+        }
+        if (start < end && end % reps) {  // Last point only partly held
+            const size_t from = std::max(start, (end / reps) * reps);
+            parts.push_back(PointPiece(whole, PointOffset(whole, from), from % reps, end % reps));
+            end = from;
+        }
+
+        auto walk = std::make_shared<PointWalk>();
+        walk->policy = policy;
+        for (size_t k = start; k < end; k += reps) walk->points.push_back((uint32_t)PointOffset(whole, k));
+        if (policy == SchedulePolicy::FIFO || walk->points.size() < 2) {
+            std::sort(walk->points.begin(), walk->points.end());
+            for (size_t i = 0; i < walk->points.size();) {
+                size_t j = i + 1;
+                while (j < walk->points.size() && walk->points[j] == walk->points[j - 1] + 1) j++;
+                RunBatch part = PointPiece(whole, walk->points[i], 0, reps);
+                part.num_runs = (walk->points[j - 1] + 1) * reps;
+                parts.push_back(part);
+                i = j;
+            }
+        } else {
+            emp::vector<std::pair<double, uint32_t>> costs;
+            costs.reserve(walk->points.size());
+            for (uint32_t point : walk->points) {
+                const double cost = PointParams(whole, point).EstimateCost();
+                costs.push_back({policy == SchedulePolicy::SJF ? cost : -cost, point});
+            }
+            std::sort(costs.begin(), costs.end());  // Equal costs stay in id order.
+            for (size_t i = 0; i < costs.size(); i++) walk->points[i] = costs[i].second;
+            walk->BuildPositions();
+            RunBatch part = whole;
+            part.walk = walk;
+            part.next_run = 0;
+            part.num_runs = walk->points.size() * reps;
+            parts.push_back(part);
+        }
+
+        for (const RunBatch& part : parts) {
+            const size_t part_key = RunId(part, part.next_run);
+            batches[part_key] = part;
+            Schedule(part_key);
+        }
+    }
+
+    /// Puts a batch in the schedule, ranked by the cost of its next run. Under SJF and LJF a
+    /// sweep walks its points in cost order (see Rewalk), so each point is ranked by its own cost
+    /// as it comes up.
+    void Schedule(size_t key) {
+        RunBatch& batch = batches[key];
+        if (batch.sweep && !InPolicyOrder(batch)) {
+            Rewalk(key);
+            return;
+        }
+
+        batch.rank = 0.0;
+        if (policy != SchedulePolicy::FIFO) {
+            const double cost = PointParams(batch, PointOffset(batch, batch.next_run)).EstimateCost();
+            batch.rank = policy == SchedulePolicy::SJF ? cost : -cost;
+        }
+        schedule.insert({batch.priority, batch.rank, batch.order, key});
+    }
+
+    void Unschedule(size_t key) {
+        const RunBatch& batch = batches[key];
+        schedule.erase({batch.priority, batch.rank, batch.order, key});
+    }
+
+    /// Turns the next run of a batch into a RunInfo (the batch is left for the caller to remove
+    /// once it runs out).
+    RunInfo TakeRun(RunBatch& batch) {
+        const size_t point_offset = PointOffset(batch, batch.next_run);
+        // The first replicate of each sweep point builds its parameters; the rest share them.
+        if (batch.sweep && batch.next_run % batch.replicates == 0) {
+            batch.params = std::make_shared<const PDParams>(PointParams(batch, point_offset));
+        }
+        const size_t id = RunId(batch, batch.next_run);
+        batched_runs--;
+        batch.next_run++;
+        RunInfo run(batch.params, id, batch.first_point + point_offset, batch.replicates, CounterRandom::DeriveSeed(base_seed, id));
+        run.queued_at = batch.queued_at;
+        return run;
+    }
+
+    /// Finds the batch that still holds run id.
+    /// @return its key, or false if no batch does; index is the run's number within the batch
+    bool FindBatch(size_t id, size_t& key, size_t& index) const {
+        // Batches in id order are keyed by their first id; only sweeps walked in cost order
+        // (which hold ids both below and above their key) need the slow search.
+        auto it = batches.upper_bound(id);
+        if (it != batches.begin() && FindRun(std::prev(it)->second, id, index)) {
+            key = std::prev(it)->first;
+            return true;
+        }
+        for (const auto& [batch_key, batch] : batches) {
+            if (batch.walk && FindRun(batch, id, index)) {
+                key = batch_key;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// Splits run id (the index-th of the batch with key) off into a batch of its own, keyed by
+    /// id. The runs before and after it stay where they were in the schedule.
+    void SplitOff(size_t key, size_t id, size_t index) {
+        Unschedule(key);
+        const RunBatch batch = batches[key];
+        if (index + 1 < batch.num_runs) {
+            const size_t next_key = RunId(batch, index + 1);
+            batches[next_key] = Piece(batch, index + 1, batch.num_runs);
+            Schedule(next_key);
+        }
+        if (batch.next_run < index) {
+            batches[key].num_runs = index;
+            Schedule(key);
+        } else {
+            batches.erase(key);
+        }
+        batches[id] = Piece(batch, index, index + 1);
+        Schedule(id);
+    }
+
+    /// Makes sure the front of the queue has been expanded into a RunInfo (runs_mutex must be held).
+    /// @return false if the queue is empty
+    bool ExpandFront() {
+        if (!runs.empty()) return true;
+        if (schedule.empty()) return false;
+
+        const size_t key = schedule.begin()->batch;
+        Unschedule(key);
+        RunBatch& batch = batches[key];
+        runs.push_back(TakeRun(batch));
+        if (batch.next_run == batch.num_runs) batches.erase(key);
+        else Schedule(key);
+        return true;
+    }
+
+    /// Counts a run taken off the queue, and how long it waited there.
+    /// @return the wait, in seconds
+    double NoteTaken(const RunInfo& run) {
+        const uint64_t wait = PerfNanoseconds(run.queued_at, std::chrono::steady_clock::now());
+#if QM_PERF
+        std::lock_guard<std::mutex> lock(perf_mutex);
+        perf.runs_taken++;
+        perf.wait_ns += wait;
+        perf.max_wait_ns = std::max(perf.max_wait_ns, wait);
+#endif
+        return (double)wait * 1e-9;
+    }
+
+    /// Text of the perf column for a run: its world's counters so far, and its wait (in seconds).
+    static std::string FormatPerf(const WorldPerf& w, double wait) {
+        const double repro = w.repro_calls ? (double)w.repro_calls : 1.0;
+        return emp::to_string(w.epochs ? (double)w.run_ns * 1e-6 / (double)w.epochs : 0.0, " ms/epoch, ",
+                              (double)w.neighbors_scanned / repro, " nbrs/repro, ", (double)w.flips / repro,
+                              " flips/repro, setup ", (double)w.setup_ns * 1e-6, " ms, waited ", wait, " s");
+    }
+
+    static constexpr uint32_t QUEUE_STATE_MAGIC = 0x36514D51;  // "QMQ6"
+
+    /// when as wall-clock nanoseconds since the epoch, since another process (or a later one)
+    /// has a steady_clock of its own; FromWallTime reads it back.
+    static int64_t ToWallTime(std::chrono::steady_clock::time_point when) {
+        const auto wall = std::chrono::system_clock::now() - (std::chrono::steady_clock::now() - when);
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(wall.time_since_epoch()).count();
+    }
+
+    static std::chrono::steady_clock::time_point FromWallTime(int64_t ns) {
+        const std::chrono::system_clock::time_point wall(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(ns)));
+        return std::chrono::steady_clock::now() - (std::chrono::system_clock::now() - wall);
+    }
 
    public:
+    /// Writes one run (as SaveQueue does).
+    static void SaveRun(std::ostream& os, const RunInfo& run) {
+        WriteBinary(os, *run.params);
+        WriteBinary<uint64_t>(os, run.id);
+        WriteBinary<uint64_t>(os, run.point_id);
+        WriteBinary<uint64_t>(os, run.replicates);
+        WriteBinary(os, run.seed);
+        WriteBinary<uint64_t>(os, run.cur_epoch);
+        WriteBinary(os, run.stop_reason);
+        WriteBinary(os, ToWallTime(run.queued_at));
+    }
+
+    /// Reads a run written by SaveRun.
+    /// @return false if the stream ran out
+    static bool LoadRun(std::istream& is, RunInfo& run) {
+        PDParams params;
+        uint64_t id, point_id, replicates, cur_epoch;
+        int64_t queued_at;
+        if (!ReadBinary(is, params) || !ReadBinary(is, id) || !ReadBinary(is, point_id) || !ReadBinary(is, replicates) ||
+            !ReadBinary(is, run.seed) || !ReadBinary(is, cur_epoch) ||
+            !ReadBinary(is, run.stop_reason) || !ReadBinary(is, queued_at)) {
+            return false;
+        }
+        run.queued_at = FromWallTime(queued_at);
+        run.params = std::make_shared<const PDParams>(params);
+        run.id = id;
+        run.point_id = point_id;
+        run.replicates = replicates;
+        run.cur_epoch = cur_epoch;
+        return true;
+    }
+
     void SetEpoch(size_t epoch) { epoch_ = epoch; }
-    void SetNumCoop(size_t coop) { coop_ = coop; }
+    void SetStopReason(StopReason reason) { stop_ = reason; }
+    /// The value the cross-replicate summaries track (for SimplePDWorld, the cooperator fraction).
+    void SetSampleValue(double value) { sample_ = value; }
+    /// Counters of the world running the front run (shown in the perf column; see DivTableCalc).
+    void SetWorldPerf(const WorldPerf& world_perf) { world_perf_ = world_perf; }
+
+    /// Counts the wall-clock time of a finished run (with QM_PERF=1); safe to call from any thread.
+    void AddRunTime(double seconds) {
+#if QM_PERF
+        const uint64_t ns = (uint64_t)(seconds * 1e9);
+        std::lock_guard<std::mutex> lock(perf_mutex);
+        perf.runs_timed++;
+        perf.run_ns += ns;
+        perf.max_run_ns = std::max(perf.max_run_ns, ns);
+#else
+        (void)seconds;
+#endif
+    }
+
+    /// The timers so far (all zero unless built with QM_PERF=1).
+    QueuePerf GetPerf() const {
+        std::lock_guard<std::mutex> lock(perf_mutex);
+        return perf;
+    }
+
+    /// Adds a metric column to the results table (before DivAddTable).
+    /// @return its slot, for SetMetric
+    size_t AddMetric(const std::string& name) {
+        metrics.push_back({name, 0, 0.0});
+        return metrics.size() - 1;
+    }
+    /// Sets the front run's current value of the metric in slot (see DivTableCalc).
+    void SetMetric(size_t slot, double value) { metrics[slot].value = value; }
+    double GetMetric(size_t slot) const { return metrics[slot].value; }
+    size_t GetNumMetrics() const { return metrics.size(); }
+    const std::string& GetMetricName(size_t slot) const { return metrics[slot].name; }
 
     /// Default constructor
     QueueManager() = default;
 
     /// Config constructor
-    QueueManager(SettingConfig user_config) : queue_config(user_config) { ; }
+    QueueManager(SettingConfig user_config) : queue_config(user_config), queue_params(PDParams::FromConfig(user_config)) { ; }
+
+    /// Sets the seed that every run's own seed is derived from (together with the run's id).
+    /// A run's seed is fixed when it reaches the front of the queue.
+    void SetBaseSeed(uint64_t seed) {
+        std::lock_guard<std::mutex> lock(runs_mutex);
+        base_seed = seed;
+    }
+    uint64_t GetBaseSeed() const {
+        std::lock_guard<std::mutex> lock(runs_mutex);
+        return base_seed;
+    }
+
+    /// Sets the conditions for ending runs early; applies to runs added after this call.
+    void SetStopConditions(const StopConditions& stop) {
+        std::lock_guard<std::mutex> lock(runs_mutex);
+        stop_conditions = stop;
+    }
+    StopConditions GetStopConditions() const {
+        std::lock_guard<std::mutex> lock(runs_mutex);
+        return stop_conditions;
+    }
 
     /// Checks if queue is empty
-    bool IsEmpty() {
-        return runs.empty();
+    bool IsEmpty() const {
+        std::lock_guard<std::mutex> lock(runs_mutex);
+        return runs.empty() && schedule.empty();
     }
 
     /// Checks how runs are in the queue
-    size_t RunsRemaining() {
-        return runs.size();
+    size_t RunsRemaining() const {
+        std::lock_guard<std::mutex> lock(runs_mutex);
+        return runs.size() + batched_runs;
+    }
+
+    /// Number of batches the runs not yet scheduled are held in (each takes one schedule entry).
+    size_t GetNumBatches() const {
+        std::lock_guard<std::mutex> lock(runs_mutex);
+        return batches.size();
     }
 
     /// Adds run to queue with run info for paramters
-    void AddRun(SettingConfig other) {
-        RunInfo new_run(other, runs.size());
-        runs.push(new_run);
+    void AddRun(const SettingConfig& other) {
+        AddRuns(other, 1);
+    }
+
+    /// Adds count replicate runs of one configuration.
+    /// @return id of the first run added; the rest follow consecutively
+    size_t AddRuns(const SettingConfig& other, size_t count) {
+        std::lock_guard<std::mutex> lock(runs_mutex);
+        if (count == 0) return next_id;
+        PDParams point_params = PDParams::FromConfig(other);
+        point_params.stop = stop_conditions;
+        auto params = std::make_shared<const PDParams>(point_params);
+        const size_t first_id = next_id;
+        batches[first_id] = {params, nullptr, nullptr, first_id, next_point, count, count, 0, add_priority, next_order++};
+        Schedule(first_id);
+        batched_runs += count;
+        next_id += count;
+        next_point++;
+        return first_id;
+    }
+
+    /// Adds every run of a sweep, which fills in settings from base_config for anything it does
+    /// not vary. Runs are expanded only as they reach the front of the queue. Every axis must
+    /// name a PDParams setting (parse specs with PDParams::SettingNames to check).
+    /// @return id of the first run added; the rest follow consecutively. A sweep of an unknown
+    /// setting, of a setting twice, or of too many points (see ParamSweep::IsTooLarge) adds nothing.
+    size_t AddSweep(const SettingConfig& base_config, const ParamSweep& sweep) {
+        std::lock_guard<std::mutex> lock(runs_mutex);
+        if (!IsPDSweep(sweep) || sweep.HasRepeatedAxis() || sweep.IsTooLarge() || sweep.GetNumRuns() == 0) return next_id;
+        PDParams point_params = PDParams::FromConfig(base_config);
+        point_params.stop = stop_conditions;
+        auto base_params = std::make_shared<const PDParams>(point_params);
+        auto sweep_ptr = std::make_shared<const ParamSweep>(sweep);
+        const size_t first_id = next_id;
+        batches[first_id] = {base_params, sweep_ptr, nullptr, first_id, next_point, sweep.GetReplicates(),
+                             sweep.GetNumRuns(), 0, add_priority, next_order++};
+        Schedule(first_id);
+        batched_runs += sweep.GetNumRuns();
+        next_id += sweep.GetNumRuns();
+        next_point += sweep.GetNumPoints();
+        return first_id;
+    }
+
+    /// Sets the order runs of equal priority are taken in (see SchedulePolicy); applies to every
+    /// run not yet at the front of the queue.
+    void SetSchedule(SchedulePolicy _policy) {
+        std::lock_guard<std::mutex> lock(runs_mutex);
+        policy = _policy;
+        schedule.clear();
+        emp::vector<size_t> keys;
+        for (const auto& p : batches) keys.push_back(p.first);
+        for (size_t key : keys) Schedule(key);
+    }
+    SchedulePolicy GetSchedule() const {
+        std::lock_guard<std::mutex> lock(runs_mutex);
+        return policy;
+    }
+
+    /// Sets the priority of runs added after this call (higher runs sooner; default 0).
+    void SetPriority(int priority) {
+        std::lock_guard<std::mutex> lock(runs_mutex);
+        add_priority = priority;
+    }
+
+    /// Changes the priority of a queued run.
+    /// @return false if run id is not queued, or has already been scheduled (see PopRun)
+    bool Reprioritize(size_t id, int priority) {
+        std::lock_guard<std::mutex> lock(runs_mutex);
+        size_t key, index;
+        if (!FindBatch(id, key, index)) return false;
+        SplitOff(key, id, index);
+        Unschedule(id);
+        batches[id].priority = priority;
+        Schedule(id);
+        return true;
+    }
+
+    /// Highest priority of any run still to be scheduled (0 if there are none).
+    int GetTopPriority() const {
+        std::lock_guard<std::mutex> lock(runs_mutex);
+        return schedule.empty() ? 0 : schedule.begin()->priority;
+    }
+
+    /// Takes run id off the queue without running it, moving it into cancelled. Its point's
+    /// summary expects one replicate fewer from now on, so the summary may be complete after this
+    /// (see GetSummary), or be dropped if no replicate of the point is left.
+    /// @return false if run id is not queued
+    bool CancelRun(size_t id, RunInfo& cancelled) {
+        std::lock_guard<std::mutex> lock(runs_mutex);
+        auto run = std::find_if(runs.begin(), runs.end(), [id](const RunInfo& queued) { return queued.id == id; });
+        size_t key, index;
+        if (run != runs.end()) {
+            if (run == runs.begin()) front_samples.clear();
+            cancelled = std::move(*run);
+            runs.erase(run);
+        } else if (FindBatch(id, key, index)) {
+            SplitOff(key, id, index);
+            Unschedule(id);
+            cancelled = TakeRun(batches[id]);
+            batches.erase(id);
+        } else {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> summary_lock(summary_mutex);
+        PointSummary& summary = summaries[cancelled.point_id];
+        if (!summary.params) {
+            summary.params = cancelled.params;
+            summary.runs_expected = cancelled.replicates;
+            summary.samples.resize(GetNumSamples(cancelled.params->E));
+        }
+        summary.runs_expected--;
+        if (summary.runs_expected == 0) summaries.erase(cancelled.point_id);
+        return true;
+    }
+
+    /// Writes every run still to do, with the seed counters, so LoadQueue can pick up where this
+    /// queue is now. Runs that were taken off the queue but not finished (in_flight) are saved
+    /// ahead of the rest, so they are the first to be taken again after a restore.
+    void SaveQueue(std::ostream& os, const emp::vector<RunInfo>& in_flight = {}) const {
+        std::lock_guard<std::mutex> lock(runs_mutex);
+        WriteBinary(os, QUEUE_STATE_MAGIC);
+        WriteBinary(os, base_seed);
+        WriteBinary<uint64_t>(os, next_id);
+        WriteBinary<uint64_t>(os, next_point);
+
+        WriteBinary<uint64_t>(os, in_flight.size() + runs.size());
+        for (const RunInfo& run : in_flight) SaveRun(os, run);
+        for (const RunInfo& run : runs) SaveRun(os, run);
+
+        WriteBinary(os, next_order);
+        WriteBinary<uint64_t>(os, batches.size());
+        for (const auto& p : batches) {
+            const RunBatch& batch = p.second;
+            WriteBinary<uint64_t>(os, p.first);
+            WriteBinary(os, *batch.params);
+            WriteBinary<uint8_t>(os, batch.sweep != nullptr);
+            if (batch.sweep) batch.sweep->SaveState(os);
+            WriteBinary<uint8_t>(os, batch.walk != nullptr);
+            if (batch.walk) {
+                WriteBinary<uint8_t>(os, (uint8_t)batch.walk->policy);
+                WriteBinary(os, batch.walk->points);
+            }
+            WriteBinary<uint64_t>(os, batch.first_id);
+            WriteBinary<uint64_t>(os, batch.first_point);
+            WriteBinary<uint64_t>(os, batch.replicates);
+            WriteBinary<uint64_t>(os, batch.num_runs);
+            WriteBinary<uint64_t>(os, batch.next_run);
+            WriteBinary<int64_t>(os, batch.priority);
+            WriteBinary(os, batch.order);
+            WriteBinary(os, ToWallTime(batch.queued_at));
+        }
+        WriteBinary<uint8_t>(os, (uint8_t)policy);
+
+        std::lock_guard<std::mutex> summary_lock(summary_mutex);
+        WriteBinary<uint64_t>(os, summary_interval);
+        WriteBinary<uint64_t>(os, summaries.size());
+        for (const auto& p : summaries) {
+            const PointSummary& summary = p.second;
+            WriteBinary<uint64_t>(os, p.first);
+            WriteBinary(os, *summary.params);
+            WriteBinary<uint64_t>(os, summary.runs_expected);
+            WriteBinary<uint64_t>(os, summary.runs_done);
+            WriteBinary<uint64_t>(os, summary.samples.size());
+            for (const SampleSummary& sample : summary.samples) sample.SaveState(os);
+        }
+    }
+
+    /// Replaces the contents of this queue with a snapshot written by SaveQueue, summary interval
+    /// included; the runs are ordered by this queue's schedule policy.
+    /// @return false if the stream does not hold a complete snapshot (the queue is then left empty)
+    bool LoadQueue(std::istream& is) {
+        SchedulePolicy saved_policy;
+        return LoadQueue(is, false, saved_policy);
+    }
+
+    /// Replaces the contents of this queue with a snapshot written by SaveQueue. The snapshot's
+    /// summary interval replaces this queue's unless keep_settings is set, and its schedule
+    /// policy is handed back in saved_policy; either way the runs are ordered by this queue's
+    /// policy. SharedQueue, which reloads the queue while workers read the interval, keeps both
+    /// settings as they were when it joined.
+    /// @return false if the stream does not hold a complete snapshot (the queue is then left
+    /// empty), or if keep_settings is set and the snapshot was saved with another summary interval
+    bool LoadQueue(std::istream& is, bool keep_settings, SchedulePolicy& saved_policy) {
+        std::lock_guard<std::mutex> lock(runs_mutex);
+        std::lock_guard<std::mutex> summary_lock(summary_mutex);
+        runs.clear();
+        batches.clear();
+        schedule.clear();
+        batched_runs = 0;
+        summaries.clear();
+
+        uint32_t magic = 0;
+        uint64_t id64, point64, num_runs, num_batches;
+        if (!ReadBinary(is, magic) || magic != QUEUE_STATE_MAGIC || !ReadBinary(is, base_seed) ||
+            !ReadBinary(is, id64) || !ReadBinary(is, point64) || !ReadBinary(is, num_runs)) {
+            return false;
+        }
+        next_id = id64;
+        next_point = point64;
+
+        for (uint64_t i = 0; i < num_runs; i++) {
+            RunInfo run;
+            if (!LoadRun(is, run)) return false;
+            runs.push_back(std::move(run));
+        }
+
+        if (!ReadBinary(is, next_order) || !ReadBinary(is, num_batches)) return false;
+        for (uint64_t i = 0; i < num_batches; i++) {
+            uint64_t key;
+            PDParams params;
+            uint8_t has_sweep = 0;
+            if (!ReadBinary(is, key) || !ReadBinary(is, params) || !ReadBinary(is, has_sweep)) return false;
+            std::shared_ptr<ParamSweep> sweep;
+            if (has_sweep) {
+                sweep = std::make_shared<ParamSweep>();
+                if (!sweep->LoadState(is)) return false;
+            }
+            uint8_t has_walk = 0;
+            if (!ReadBinary(is, has_walk)) return false;
+            std::shared_ptr<PointWalk> walk;
+            if (has_walk) {
+                uint8_t walk_policy;
+                walk = std::make_shared<PointWalk>();
+                if (!ReadBinary(is, walk_policy) || !ReadBinary(is, walk->points) || walk->points.empty()) return false;
+                walk->policy = (SchedulePolicy)walk_policy;
+                walk->BuildPositions();
+            }
+            uint64_t first_id, first_point, replicates, batch_runs, next_run, order;
+            int64_t priority, queued_at;
+            if (!ReadBinary(is, first_id) || !ReadBinary(is, first_point) || !ReadBinary(is, replicates) ||
+                !ReadBinary(is, batch_runs) || !ReadBinary(is, next_run) || !ReadBinary(is, priority) ||
+                !ReadBinary(is, order) || !ReadBinary(is, queued_at) || replicates == 0 || next_run >= batch_runs ||
+                (walk && (!sweep || batch_runs > walk->points.size() * replicates))) {
+                return false;
+            }
+            batches[key] = {std::make_shared<const PDParams>(params), sweep, walk, first_id, first_point, replicates,
+                            batch_runs, next_run, (int)priority, order};
+            batches[key].queued_at = FromWallTime(queued_at);
+            Schedule(key);
+            batched_runs += batch_runs - next_run;
+        }
+
+        uint8_t policy_id;
+        uint64_t interval, num_summaries;
+        if (!ReadBinary(is, policy_id) || policy_id > (uint8_t)SchedulePolicy::LJF || !ReadBinary(is, interval) ||
+            !ReadBinary(is, num_summaries) || (keep_settings && interval != summary_interval)) {
+            return false;
+        }
+        saved_policy = (SchedulePolicy)policy_id;
+        if (!keep_settings) summary_interval = interval;
+        for (uint64_t i = 0; i < num_summaries; i++) {
+            uint64_t point_id, runs_expected, runs_done, num_samples;
+            PDParams params;
+            if (!ReadBinary(is, point_id) || !ReadBinary(is, params) || !ReadBinary(is, runs_expected) ||
+                !ReadBinary(is, runs_done) || !ReadBinary(is, num_samples)) {
+                return false;
+            }
+            PointSummary& summary = summaries[point_id];
+            summary.params = std::make_shared<const PDParams>(params);
+            summary.runs_expected = runs_expected;
+            summary.runs_done = runs_done;
+            summary.samples.resize(num_samples);
+            for (SampleSummary& sample : summary.samples) {
+                if (!sample.LoadState(is)) return false;
+            }
+        }
+        return true;
+    }
+
+    /// Sets how many epochs apart the cross-replicate summaries sample each run (set before runs start).
+    void SetSummaryInterval(size_t interval) { summary_interval = interval ? interval : 1; }
+    size_t GetSummaryInterval() const { return summary_interval; }
+
+    /// How many summary samples a run of E epochs has.
+    size_t GetNumSamples(size_t E) const { return (E + summary_interval - 1) / summary_interval; }
+
+    /// The epoch summary sample index is taken at: every summary_interval epochs, and the last at E.
+    size_t GetSampleEpoch(size_t index, size_t E) const { return std::min((index + 1) * summary_interval, E); }
+
+    /// Completes the samples of a run that stopped early at fixation or a steady state with its
+    /// final cooperator fraction for every sample epoch it did not reach (a fixed population stays
+    /// fixed). Runs stopped by the time budget are left short, and only count towards the epochs
+    /// they reached.
+    void FillSamples(const RunInfo& run, emp::vector<double>& coop_fractions, double final_fraction) const {
+        if (run.stop_reason != StopReason::FIXATION && run.stop_reason != StopReason::STEADY) return;
+        coop_fractions.resize(std::max(coop_fractions.size(), GetNumSamples(run.params->E)), final_fraction);
+    }
+
+    /// Adds a finished run's cooperator fraction at each sample epoch (in order) to the summary of
+    /// its point; safe to call from any thread.
+    /// @return true if that was the last replicate of the point
+    bool AddRunSamples(const RunInfo& run, const emp::vector<double>& coop_fractions) {
+        std::lock_guard<std::mutex> lock(summary_mutex);
+        PointSummary& summary = summaries[run.point_id];
+        if (!summary.params) {
+            summary.params = run.params;
+            summary.runs_expected = run.replicates;
+            summary.samples.resize(GetNumSamples(run.params->E));
+        }
+        const size_t count = std::min(coop_fractions.size(), summary.samples.size());
+        for (size_t i = 0; i < count; i++) summary.samples[i].Add(coop_fractions[i]);
+        summary.runs_done++;
+        return summary.IsComplete();
+    }
+
+    /// Copies the summary of a point into out.
+    /// @return false if no run of that point has finished
+    bool GetSummary(size_t point_id, PointSummary& out) const {
+        std::lock_guard<std::mutex> lock(summary_mutex);
+        auto it = summaries.find(point_id);
+        if (it == summaries.end()) return false;
+        out = it->second;
+        return true;
+    }
+
+    /// Forgets the summary of a point (e.g. once it has been written out).
+    void RemoveSummary(size_t point_id) {
+        std::lock_guard<std::mutex> lock(summary_mutex);
+        summaries.erase(point_id);
+    }
+
+    /// Column names matching WriteSummary.
+    static void WriteSummaryHeader(std::ostream& os) {
+        os << "point,r,u,N,E,epoch,runs,coop_mean,coop_variance,coop_min,coop_max,coop_q10,coop_q50,coop_q90" << std::endl;
+    }
+
+    /// Writes one CSV line per sample epoch of a point's summary; values are cooperator fractions.
+    void WriteSummary(std::ostream& os, size_t point_id) const {
+        PointSummary summary;
+        if (!GetSummary(point_id, summary)) return;
+        const PDParams& params = *summary.params;
+        for (size_t i = 0; i < summary.samples.size(); i++) {
+            const SampleSummary& sample = summary.samples[i];
+            if (sample.stats.count == 0) continue;
+            os << point_id << ',' << params.r << ',' << params.u << ',' << params.N << ',' << params.E << ','
+               << GetSampleEpoch(i, params.E) << ',' << sample.stats.count << ',' << sample.stats.mean << ','
+               << sample.stats.GetVariance() << ',' << sample.stats.min << ',' << sample.stats.max << ','
+               << sample.Quantile(0.1) << ',' << sample.Quantile(0.5) << ','
+               << sample.Quantile(0.9) << '\n';
+        }
+        os.flush();
+    }
+
+    /// Takes the run at the front of the queue, if any, moving it into out.
+    /// @return false if the queue was empty
+    bool PopRun(RunInfo& out) {
+        std::lock_guard<std::mutex> lock(runs_mutex);
+        if (!ExpandFront()) return false;
+        out = std::move(runs.front());
+        runs.pop_front();
+        NoteTaken(out);
+        return true;
+    }
+
+    /// Puts a run that was taken off the queue but not finished back at the front, so it is the
+    /// next run taken.
+    void ReturnRun(const RunInfo& run) {
+        std::lock_guard<std::mutex> lock(runs_mutex);
+        runs.push_front(run);
     }
 
     /// Remove run from front of queue
     void RemoveRun() {
         emp_assert(!IsEmpty(), "Queue is empty! Cannot remove!");
-        runs.pop();
+        std::lock_guard<std::mutex> lock(runs_mutex);
+        ExpandFront();
+        runs.pop_front();
     }
 
     /// Front Run Getter
     RunInfo& FrontRun() {
         emp_assert(!IsEmpty(), "Queue is empty! Cannot access Front!");
+        std::lock_guard<std::mutex> lock(runs_mutex);
+        ExpandFront();
         return runs.front();
     }
 
@@ -126,66 +1055,256 @@ class QueueManager {
 
         /* if adding more features after this point, keep in mind of where
         the col count will be */
-        for (auto& i : ordered_names) {
-            i.second = column_count;
-            result_tab.GetCell(0, column_count++).SetHeader() << i.first;
+        epoch_column = column_count;
+        result_tab.GetCell(0, column_count++).SetHeader() << "Epoch";
+        for (MetricColumn& metric : metrics) {
+            metric.column = column_count;
+            result_tab.GetCell(0, column_count++).SetHeader() << metric.name;
         }
+#if QM_PERF
+        perf_column = column_count;
+        result_tab.GetCell(0, column_count++).SetHeader() << "Perf";
+#endif
+        table_cols = column_count;
 
         display_div << result_tab;
+        result_table = std::make_unique<emp::web::Table>(result_tab);
+
+        // Paging through long queues.
+        table_position = emp::web::Text(table_id + "_position");
+        display_div << "<br>" << table_position << " ";
+        display_div << emp::web::Button([this]() {
+            table_follow = false;
+            table_first = table_first > table_window ? table_first - table_window : 0;
+            DivRedrawTable();
+        },
+                                        "Earlier rows", table_id + "_earlier");
+        display_div << emp::web::Button([this]() {
+            table_follow = false;
+            table_first += table_window;
+            DivRedrawTable();
+        },
+                                        "Later rows", table_id + "_later");
+        display_div << emp::web::Button([this]() {
+            table_follow = true;
+            size_t row;
+            if (!IsEmpty() && FindRunRow(FrontRun().id, row)) table_first = row;
+            DivRedrawTable();
+        },
+                                        "Follow current run", table_id + "_follow");
     }
 
-    /// Extends table once button is clicked
-    void DivButtonTable(int run_id) {
-        emp::web::Table my_table = display_div.Find(table_id);
+    /// @return the number of rows of the results table, below its header
+    size_t GetNumTableRows() const { return table_num_rows; }
 
-        // Update the table.
-        int line_id = my_table.GetNumRows();
-        my_table.Rows(line_id + 1);
-        int col_count = 0;
-        my_table.GetCell(line_id, col_count) << run_id;
-        for (auto p : queue_config.GetSettingMapBase()) {
-            my_table.GetCell(line_id, ++col_count) << (*p).AsString();
+    /// Finds the table row of run id.
+    /// @return false if the run has no row
+    bool FindRunRow(size_t id, size_t& row) const {
+        auto it = run_blocks.upper_bound(id);
+        if (it == run_blocks.begin()) return false;
+        const TableBlock& block = table_blocks[std::prev(it)->second];
+        if (id >= block.first_id + block.num_rows) return false;
+        row = block.first_row + (id - block.first_id);
+        return true;
+    }
+
+    /// Makes the text of a table row in cells.
+    void MakeTableRow(size_t row, emp::vector<std::string>& cells) const {
+        auto it = std::upper_bound(table_blocks.begin(), table_blocks.end(), row,
+                                   [](size_t r, const TableBlock& block) { return r < block.first_row; });
+        const TableBlock& block = *std::prev(it);
+        cells.assign(table_cols, "");
+        for (size_t i = 0; i < block.settings.size(); i++) cells[i + 1] = block.settings[i];
+
+        if (block.point) {  // Summary row
+            const SummaryRow& summary = block.summary;
+            cells[0] = emp::to_string("<b>Point ", summary.point_id, " (", summary.count, " runs)</b>");
+            const emp::vector<std::string> setting_names = queue_config.GetSettingMapNames();
+            for (size_t i = 0; i < setting_names.size(); i++) {
+                double value = 0.0;
+                if (block.point->GetValue(setting_names[i], value)) cells[i + 1] = emp::to_string(value);
+            }
+            cells[epoch_column] = emp::to_string(summary.epoch);
+            if (metrics.size()) {
+                cells[metrics[0].column] = emp::to_string(summary.mean, " &plusmn; ", summary.sd, " (min ", summary.min,
+                                                          ", median ", summary.median, ", max ", summary.max, ")");
+            }
+            return;
+        }
+
+        const size_t id = block.first_id + (row - block.first_row);
+        cells[0] = emp::to_string(id);
+        if (block.sweep) {
+            const size_t point = (row - block.first_row) / block.sweep->GetReplicates();
+            for (size_t axis = 0; axis < block.axis_columns.size(); axis++) {
+                if (block.axis_columns[axis]) cells[block.axis_columns[axis]] = emp::to_string(block.sweep->GetValue(point, axis));
+            }
         }
+        for (size_t col = epoch_column; col < table_cols; col++) cells[col] = "Waiting...";
+        auto found = run_progress.find(id);
+        if (found == run_progress.end()) return;
+        const RunProgress& progress = found->second;
+        if (progress.started) {
+            cells[epoch_column] = emp::to_string(progress.epoch);
+            if (progress.stop_reason != StopReason::NONE && progress.stop_reason != StopReason::EPOCHS) {
+                cells[epoch_column] += emp::to_string(" (", StopReasonName(progress.stop_reason), ")");
+            }
+            for (size_t i = 0; i < progress.metrics.size(); i++) cells[metrics[i].column] = emp::to_string(progress.metrics[i]);
+            if (perf_column) cells[perf_column] = FormatPerf(progress.world_perf, progress.wait);
+        }
+        if (progress.cancelled) cells[epoch_column] = "Cancelled";
+    }
 
-        for (int i = 0; i < dependant_headers.size(); i++) {
-            my_table.GetCell(line_id, ++col_count) << "Waiting...";  // world.GetE(); world.CountCoop(); (world.GetN() - world.CountCoop());
+    /// Brings the shown window of the table up to date, touching only the cells whose text
+    /// changed (and adding rows to the page the first time the window fills up).
+    void DivRedrawTable() {
+        if (!result_table) return;
+        QM_PERF_TIME(perf.table_ns);
+        QM_PERF_COUNT(perf.table_updates, 1);
+        if (table_first + table_window > table_num_rows) {
+            table_first = table_num_rows > table_window ? table_num_rows - table_window : 0;
+        }
+        const size_t num_shown = std::min(table_window, table_num_rows);
+
+        if (table_cells.size() < num_shown) {
+            result_table->Freeze();
+            result_table->Rows(num_shown + 1);
+            while (table_cells.size() < num_shown) {
+                const size_t line_id = table_cells.size() + 1;
+                table_cells.emplace_back();
+                shown_cells.emplace_back(table_cols);
+                for (size_t col = 0; col < table_cols; col++) {
+                    emp::web::Text text(emp::to_string(table_id, "_", line_id, "_", col));
+                    result_table->GetCell(line_id, col) << text;
+                    table_cells.back().push_back(text);
+                }
+            }
+            result_table->CellsCSS("border", "1px solid black");
+            result_table->Activate();  // One redraw for all the new rows
+        }
+
+        for (size_t line = 0; line < num_shown; line++) {
+            MakeTableRow(table_first + line, row_cells);
+            for (size_t col = 0; col < table_cols; col++) {
+                const std::string& value = row_cells[col];
+                if (shown_cells[line][col] == value) continue;
+                shown_cells[line][col] = value;
+                emp::web::Text& text = table_cells[line][col];
+                text.Freeze();
+                text.Clear() << value;
+                text.Activate();
+            }
         }
 
-        // Draw the new table.
-        my_table.CellsCSS("border", "1px solid black");
-        my_table.Redraw();
+        table_position.Freeze();
+        table_position.Clear() << "Rows " << (num_shown ? table_first + 1 : 0) << " to "
+                               << table_first + num_shown << " of " << table_num_rows;
+        if (perf.table_updates) {
+            table_position << " (table updates take " << (double)perf.table_ns * 1e-6 / (double)perf.table_updates
+                           << " ms on average)";
+        }
+        table_position.Activate();
     }
 
-    /// Run info in table is updated
-    void DivInfoTable(size_t id, size_t cur_epoch, size_t num_coop, std::string num_defect) {
-        emp::web::Table my_table = display_div.Find(table_id);
-        my_table.Freeze();
-        my_table.GetCell(id + 1, 5).ClearChildren() << cur_epoch;
-        my_table.GetCell(id + 1, 6).ClearChildren() << num_coop;
-        my_table.GetCell(id + 1, 7).ClearChildren() << num_defect;
-        my_table.Activate();
+    /// Adds table rows for num_runs queued runs from first_id on, with the queue's current
+    /// settings, or for every run of sweep (queued from first_id on). Only the block is kept; the
+    /// text of each row is made while it is shown, so queueing any number of runs costs the same
+    /// (and one redraw, at the next DivRedrawTable).
+    void DivButtonTable(size_t first_id, size_t num_runs, std::shared_ptr<const ParamSweep> sweep = nullptr) {
+        if (table_cols == 0 || num_runs == 0) return;  // No table
+        TableBlock block;
+        block.first_row = table_num_rows;
+        block.num_rows = num_runs;
+        block.first_id = first_id;
+        for (SettingConfig::SettingBase* setting : queue_config.GetSettingMapBase()) block.settings.push_back(setting->AsString());
+        if (sweep) {
+            const emp::vector<std::string> setting_names = queue_config.GetSettingMapNames();
+            for (size_t axis = 0; axis < sweep->GetNumAxes(); axis++) {
+                auto name = std::find(setting_names.begin(), setting_names.end(), sweep->GetAxisName(axis));
+                block.axis_columns.push_back(name == setting_names.end() ? 0 : 1 + (name - setting_names.begin()));
+            }
+            block.sweep = std::move(sweep);
+        }
+        run_blocks[first_id] = table_blocks.size();
+        table_blocks.push_back(std::move(block));
+        table_num_rows += num_runs;
     }
 
-    /// Calculations required for updating table
+    /// Run info in table is updated: the epoch (and stop reason), and every metric's current value
+    void DivInfoTable(size_t id, size_t cur_epoch, StopReason stop_reason = StopReason::NONE) {
+        size_t row;
+        if (table_cols == 0 || !FindRunRow(id, row)) return;
+        RunProgress& progress = run_progress[id];
+        progress.started = true;
+        progress.epoch = cur_epoch;
+        progress.stop_reason = stop_reason;
+        progress.metrics.resize(metrics.size());
+        for (size_t i = 0; i < metrics.size(); i++) progress.metrics[i] = metrics[i].value;
+        if (perf_column) {
+            progress.world_perf = world_perf_;
+            progress.wait = front_wait;
+        }
+        if (table_follow && (row < table_first || row >= table_first + table_window)) table_first = row;
+        DivRedrawTable();
+    }
+
+    /// Adds a row summarizing every replicate of a point at its final epoch: the mean of the
+    /// sampled value (see SetSampleValue), with standard deviation and quantiles, in the first
+    /// metric column.
+    void DivSummaryRow(size_t point_id) {
+        PointSummary summary;
+        if (table_cols == 0 || !GetSummary(point_id, summary) || summary.samples.empty()) return;
+        const SampleSummary& last = summary.samples.back();
+        TableBlock block;
+        block.first_row = table_num_rows++;
+        for (SettingConfig::SettingBase* setting : queue_config.GetSettingMapBase()) block.settings.push_back(setting->AsString());
+        block.point = summary.params;
+        block.summary.point_id = point_id;
+        block.summary.epoch = GetSampleEpoch(summary.samples.size() - 1, summary.params->E);
+        block.summary.count = last.stats.count;
+        block.summary.mean = last.stats.mean;
+        block.summary.sd = std::sqrt(last.stats.GetVariance());
+        block.summary.min = last.stats.min;
+        block.summary.median = last.Quantile(0.5);
+        block.summary.max = last.stats.max;
+        table_blocks.push_back(std::move(block));
+        DivRedrawTable();
+    }
+
+    /// Takes in the front run's progress (SetEpoch, SetSampleValue, SetStopReason, SetMetric
+    /// and SetWorldPerf), ends the run once it reaches E or stops, and updates the table.
+    /// The front run counts as taken off the queue (see GetPerf) the first time this sees it.
     void DivTableCalc() {
-        size_t id = FrontRun().id;
         size_t current_epoch = epoch_;
         RunInfo& current_run = FrontRun();
+        const size_t id = current_run.id;
+        const size_t E = current_run.params->E;
+        if (id != perf_front_id) {
+            perf_front_id = id;
+            front_wait = NoteTaken(current_run);
+            front_start = std::chrono::steady_clock::now();
+        }
 
         current_run.cur_epoch = current_epoch;
-        current_run.num_coop = coop_;
-        // user function configuration
-        for (auto i : dependant_headers) {
-            if (i.first == "Num Defect") {
-                current_run.num_defect = (dependant_headers.begin()->second)();
-            }
+
+        // Sample at the first frame that reaches each sample epoch.
+        while (front_samples.size() < GetNumSamples(E) && current_epoch >= GetSampleEpoch(front_samples.size(), E)) {
+            front_samples.push_back(sample_);
         }
 
-        if (current_epoch >= current_run.runinfo_config.GetValue<size_t>("E_value")) {  // Are we done with this run?
-            RemoveRun();                                                                // Updates to the next run
+        bool point_done = false;
+        const size_t point_id = current_run.point_id;
+        if (current_epoch >= E || stop_ != StopReason::NONE) {  // Are we done with this run?
+            current_run.stop_reason = current_epoch >= E ? StopReason::EPOCHS : stop_;
+            FillSamples(current_run, front_samples, sample_);
+            point_done = AddRunSamples(current_run, front_samples);
+            front_samples.clear();
+            AddRunTime(std::chrono::duration<double>(std::chrono::steady_clock::now() - front_start).count());
+            RemoveRun();  // Updates to the next run
         }
 
-        DivInfoTable(id, current_epoch, current_run.num_coop, current_run.num_defect);
+        DivInfoTable(id, current_epoch, stop_);
+        if (point_done) DivSummaryRow(point_id);
     }
 
     /// Creates area for user to input how many runs will be queued
@@ -201,23 +1320,77 @@ class QueueManager {
         return num_runs;
     }
 
+    /// Creates area for user to enter an optional parameter sweep (see ParamSweep::Parse)
+    void DivAddSweepArea() {
+        emp::web::TextArea sweep_input([this](const std::string& str) {
+            sweep_spec = str;
+        },
+                                       "sweep_spec");
+        display_div << sweep_input;
+    }
+
+    /// Creates area for user to enter optional stop conditions (see StopConditions::Parse) for the
+    /// runs queued next
+    void DivAddStopArea() {
+        emp::web::TextArea stop_input([this](const std::string& str) {
+            stop_spec = str;
+        },
+                                      "stop_spec");
+        display_div << stop_input;
+    }
+
+    /// Creates controls for the queued runs: an area for a run id, with buttons to cancel that run
+    /// or move it ahead of everything still waiting, and buttons to pick the schedule policy.
+    void DivAddScheduleArea() {
+        emp::web::TextArea id_input([this](const std::string& str) {
+            schedule_id = str;
+        },
+                                    "schedule_id");
+        display_div << id_input;
+        display_div << emp::web::Button([this]() {
+            RunInfo cancelled;
+            if (schedule_id.empty() || !CancelRun(emp::from_string<size_t>(schedule_id), cancelled)) return;
+            size_t row;
+            if (table_cols && FindRunRow(cancelled.id, row)) run_progress[cancelled.id].cancelled = true;
+            PointSummary summary;
+            if (GetSummary(cancelled.point_id, summary) && summary.IsComplete()) DivSummaryRow(cancelled.point_id);
+            DivRedrawTable();
+        },
+                                        "Cancel run", "cancel_but");
+        display_div << emp::web::Button([this]() {
+            if (schedule_id.empty()) return;
+            Reprioritize(emp::from_string<size_t>(schedule_id), GetTopPriority() + 1);
+        },
+                                        "Run next", "run_next_but");
+        display_div << "<br>Among the rest, take runs ";
+        display_div << emp::web::Button([this]() { SetSchedule(SchedulePolicy::FIFO); }, "in queue order", "fifo_but");
+        display_div << emp::web::Button([this]() { SetSchedule(SchedulePolicy::SJF); }, "shortest first", "sjf_but");
+    }
+
     /// Creates queue button
     void DivButton(size_t num_runs) {
         emp::web::Button my_button([this, num_runs]() {
-            for (int run_id = 0; run_id < num_runs; run_id++) {
-                AddRun(queue_config);
-                DivButtonTable(run_id);
+            StopConditions stop;
+            if (!stop.Parse(stop_spec)) return;
+            SetStopConditions(stop);
+
+            if (sweep_spec.empty()) {
+                DivButtonTable(AddRuns(queue_config, num_runs), num_runs);
+                DivRedrawTable();
+                return;
             }
+
+            // Every point of the sweep gets num_runs replicates.
+            auto sweep = std::make_shared<ParamSweep>();
+            if (!sweep->Parse(sweep_spec, PDParams::SettingNames()) || num_runs == 0) return;
+            sweep->SetReplicates(num_runs);
+            const size_t first_id = AddSweep(queue_config, *sweep);
+            DivButtonTable(first_id, sweep->GetNumRuns(), sweep);
+            DivRedrawTable();
         },
                                    "Queue", "queue_but");
         display_div << my_button;
     }
-
-    /// Adds dependant variables to tables
-    void AddDepVariable(std::function<std::string()> func, std::string header_name) {
-        ordered_names.push_back({header_name, 0});
-        dependant_headers.insert({header_name, func});
-    }
 };
 
 }  // namespace emp
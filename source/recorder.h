@@ -0,0 +1,290 @@
+/**
+ *  @note This file is part of Empirical, https://github.com/devosoft/Empirical
+ *  @copyright Copyright (C) Michigan State University, MIT Software license; see doc/LICENSE.md
+ *  @date 2020
+ *
+ *  @file  recorder.h
+ *  @brief Records per-run time series into columnar buffers and writes them out on a background thread.
+ *  @note Status:
+ */
+
+/// A SeriesRecorder belongs to one run: the world hands it a sample every epoch, it keeps every
+/// interval-th one in preallocated column buffers, and when a buffer fills it passes the whole
+/// buffer to a SeriesWriter. The writer is shared by all runs and does the formatting and file
+/// I/O on its own thread, so the simulation loop only waits when the writer falls max_jobs buffers
+/// behind (a slow disk then slows the runs rather than growing memory without bound). Written
+/// buffers go back to the writer's free list for reuse. Each run gets one file,
+/// either CSV (epoch,num_coop,num_defect,mean_fitness,flips) or a compact binary columnar file:
+///
+///   "QMTS" magic, uint32 column count, then per column a uint8 type ('u' = uint64, 'd' = double)
+///   and a name (uint64 length + chars); then blocks of uint64 row count followed by each column's
+///   values for those rows, in column order.
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "base/vector.h"
+#include "binaryio.h"
+
+namespace emp {
+
+/// One block of samples, stored column by column.
+struct SeriesBuffer {
+    emp::vector<uint64_t> epoch;
+    emp::vector<uint64_t> num_coop;
+    emp::vector<uint64_t> num_defect;
+    emp::vector<double> mean_fitness;
+    emp::vector<uint64_t> flips;
+
+    void Reserve(size_t rows) {
+        epoch.reserve(rows);
+        num_coop.reserve(rows);
+        num_defect.reserve(rows);
+        mean_fitness.reserve(rows);
+        flips.reserve(rows);
+    }
+    size_t size() const { return epoch.size(); }
+    void clear() {
+        epoch.clear();
+        num_coop.clear();
+        num_defect.clear();
+        mean_fitness.clear();
+        flips.clear();
+    }
+};
+
+/// Background thread that writes SeriesBuffers to per-run files.
+class SeriesWriter {
+   public:
+    enum class Format { CSV, BINARY };
+
+   private:
+    struct Job {
+        size_t run_id;
+        std::unique_ptr<SeriesBuffer> buffer;  // nullptr when the job only closes the file
+        bool append;                           // Continue an existing file rather than start over
+        bool last;                             // Close the file after this job
+    };
+
+    std::string dir;
+    Format format;
+
+    std::deque<Job> jobs;
+    std::mutex jobs_mutex;
+    std::condition_variable jobs_cv;   // Signalled when a job is queued, or the writer stops
+    std::condition_variable space_cv;  // Signalled when a job is taken off a full queue
+    size_t max_jobs;                   // Submit waits while this many jobs are queued
+    size_t num_waits = 0;              // Submit calls that had to wait
+    size_t peak_jobs = 0;              // Most jobs ever queued at once
+    emp::vector<std::unique_ptr<SeriesBuffer>> free_buffers;  // Written buffers, for TakeBuffer
+    bool stopping = false;
+    std::thread thread;
+
+    std::map<size_t, std::ofstream> files;  // Only touched by the writer thread
+
+    std::string FileName(size_t run_id) const {
+        return dir + "/series-" + std::to_string(run_id) + (format == Format::CSV ? ".csv" : ".bin");
+    }
+
+    void OpenFile(size_t run_id, bool append) {
+        std::ofstream& file = files[run_id];
+        if (append) {
+            file.open(FileName(run_id), std::ios::binary | std::ios::app);
+            return;
+        }
+        file.open(FileName(run_id), std::ios::binary | std::ios::trunc);
+        if (format == Format::CSV) {
+            file << "epoch,num_coop,num_defect,mean_fitness,flips\n";
+            return;
+        }
+        file.write("QMTS", 4);
+        WriteBinary<uint32_t>(file, 5);
+        const std::pair<uint8_t, std::string> columns[] = {
+            {'u', "epoch"}, {'u', "num_coop"}, {'u', "num_defect"}, {'d', "mean_fitness"}, {'u', "flips"}};
+        for (const auto& column : columns) {
+            WriteBinary(file, column.first);
+            WriteBinary(file, column.second);
+        }
+    }
+
+    template <typename T>
+    static void WriteColumn(std::ostream& os, const emp::vector<T>& column) {
+        os.write(reinterpret_cast<const char*>(column.data()), (std::streamsize)(column.size() * sizeof(T)));
+    }
+
+    void WriteJob(Job& job) {
+        if (files.find(job.run_id) == files.end()) OpenFile(job.run_id, job.append);
+        std::ofstream& file = files[job.run_id];
+
+        if (job.buffer && job.buffer->size()) {
+            const SeriesBuffer& buf = *job.buffer;
+            if (format == Format::CSV) {
+                for (size_t i = 0; i < buf.size(); i++) {
+                    file << buf.epoch[i] << ',' << buf.num_coop[i] << ',' << buf.num_defect[i] << ','
+                         << buf.mean_fitness[i] << ',' << buf.flips[i] << '\n';
+                }
+            } else {
+                WriteBinary<uint64_t>(file, buf.size());
+                WriteColumn(file, buf.epoch);
+                WriteColumn(file, buf.num_coop);
+                WriteColumn(file, buf.num_defect);
+                WriteColumn(file, buf.mean_fitness);
+                WriteColumn(file, buf.flips);
+            }
+        }
+
+        if (job.last) files.erase(job.run_id);
+    }
+
+    void Loop() {
+        std::unique_lock<std::mutex> lock(jobs_mutex);
+        while (true) {
+            jobs_cv.wait(lock, [this]() { return stopping || !jobs.empty(); });
+            if (jobs.empty()) break;  // stopping, with nothing left to write
+            Job job = std::move(jobs.front());
+            jobs.pop_front();
+            space_cv.notify_all();
+            lock.unlock();
+            WriteJob(job);
+            lock.lock();
+            if (job.buffer && free_buffers.size() < max_jobs) free_buffers.push_back(std::move(job.buffer));
+        }
+    }
+
+   public:
+    /// Writes series files into _dir (which must exist), holding at most _max_jobs buffers that
+    /// wait to be written.
+    SeriesWriter(const std::string& _dir, Format _format = Format::CSV, size_t _max_jobs = 64)
+        : dir(_dir), format(_format), max_jobs(_max_jobs ? _max_jobs : 1), thread(&SeriesWriter::Loop, this) { ; }
+
+    /// Finishes writing everything already handed over.
+    ~SeriesWriter() {
+        {
+            std::lock_guard<std::mutex> lock(jobs_mutex);
+            stopping = true;
+        }
+        jobs_cv.notify_one();
+        thread.join();
+    }
+
+    SeriesWriter(const SeriesWriter&) = delete;
+    SeriesWriter& operator=(const SeriesWriter&) = delete;
+
+    /// Queues a buffer for writing, first waiting for room if max_jobs are already queued; safe
+    /// to call from any thread.
+    void Submit(size_t run_id, std::unique_ptr<SeriesBuffer> buffer, bool append, bool last) {
+        {
+            std::unique_lock<std::mutex> lock(jobs_mutex);
+            if (jobs.size() >= max_jobs) {
+                num_waits++;
+                space_cv.wait(lock, [this]() { return jobs.size() < max_jobs; });
+            }
+            jobs.push_back({run_id, std::move(buffer), append, last});
+            if (jobs.size() > peak_jobs) peak_jobs = jobs.size();
+        }
+        jobs_cv.notify_one();
+    }
+
+    /// An empty buffer with room for rows samples, reusing one already written if there is one.
+    std::unique_ptr<SeriesBuffer> TakeBuffer(size_t rows) {
+        std::unique_ptr<SeriesBuffer> buffer;
+        {
+            std::lock_guard<std::mutex> lock(jobs_mutex);
+            if (free_buffers.size()) {
+                buffer = std::move(free_buffers.back());
+                free_buffers.pop_back();
+            }
+        }
+        if (!buffer) buffer.reset(new SeriesBuffer);
+        buffer->clear();
+        buffer->Reserve(rows);
+        return buffer;
+    }
+
+    size_t GetMaxJobs() const { return max_jobs; }
+
+    /// How many Submit calls had to wait for room, and the most jobs ever queued at once.
+    size_t GetNumWaits() {
+        std::lock_guard<std::mutex> lock(jobs_mutex);
+        return num_waits;
+    }
+    size_t GetPeakJobs() {
+        std::lock_guard<std::mutex> lock(jobs_mutex);
+        return peak_jobs;
+    }
+};
+
+/// Samples one run's time series; see the notes at the top of this file.
+class SeriesRecorder {
+   private:
+    SeriesWriter& writer;
+    size_t interval;        // Keep samples from epochs that are multiples of this
+    size_t buffer_rows;     // Samples per buffer handed to the writer
+    size_t run_id = 0;
+    bool active = false;
+    bool append = false;    // The first buffer of this run continues an existing file
+    std::unique_ptr<SeriesBuffer> buffer;
+
+    void NewBuffer() { buffer = writer.TakeBuffer(buffer_rows); }
+
+   public:
+    SeriesRecorder(SeriesWriter& _writer, size_t _interval = 10, size_t _buffer_rows = 1024)
+        : writer(_writer), interval(_interval ? _interval : 1), buffer_rows(_buffer_rows ? _buffer_rows : 1) { ; }
+
+    ~SeriesRecorder() { Finish(); }
+
+    size_t GetInterval() const { return interval; }
+
+    /// Begins the series for a run. With append set (e.g. a run resumed from a checkpoint), samples
+    /// are added to the end of the run's existing file instead of starting it over.
+    void Start(size_t _run_id, bool _append = false) {
+        Finish();
+        run_id = _run_id;
+        append = _append;
+        active = true;
+        NewBuffer();
+    }
+
+    /// Offers the state at the end of an epoch; kept only on sampled epochs.
+    void Record(size_t epoch, size_t num_coop, size_t num_defect, double mean_fitness, size_t flips) {
+        if (!active || epoch % interval != 0) return;
+        if (buffer->size() && buffer->epoch.back() == epoch) return;  // Already have this epoch.
+        buffer->epoch.push_back(epoch);
+        buffer->num_coop.push_back(num_coop);
+        buffer->num_defect.push_back(num_defect);
+        buffer->mean_fitness.push_back(mean_fitness);
+        buffer->flips.push_back(flips);
+        if (buffer->size() == buffer_rows) {
+            writer.Submit(run_id, std::move(buffer), append, false);
+            append = true;
+            NewBuffer();
+        }
+    }
+
+    /// Hands over the samples so far without ending the run (e.g. alongside a checkpoint).
+    void Flush() {
+        if (!active || buffer->size() == 0) return;
+        writer.Submit(run_id, std::move(buffer), append, false);
+        append = true;
+        NewBuffer();
+    }
+
+    /// Hands over what is left of the current run and closes its file.
+    void Finish() {
+        if (!active) return;
+        writer.Submit(run_id, std::move(buffer), append, true);
+        active = false;
+    }
+};
+
+}  // namespace emp
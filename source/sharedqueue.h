@@ -0,0 +1,344 @@
+/**
+ *  @note This file is part of Empirical, https://github.com/devosoft/Empirical
+ *  @copyright Copyright (C) Michigan State University, MIT Software license; see doc/LICENSE.md
+ *  @date 2020
+ *
+ *  @file  sharedqueue.h
+ *  @brief A run queue kept in a directory, so that several native processes can work through it together.
+ *  @note Status:
+ */
+
+/// The directory holds:
+///
+///     queue.lock         locked (fcntl, whole file) around every change to the queue
+///     queue.state        the queue (QueueManager::SaveQueue, with when each run was queued and
+///                        the schedule policy) and the leased runs, with the process holding
+///                        each one; replaced atomically and synced to disk (see WriteFileAtomic)
+///     owner-HOST-PID.lock  one per live process, locked by that process for as long as it lives
+///     results.csv        one line per finished run, appended by whichever process ran it
+///     summary.csv        one block per completed point (see QueueManager::WriteSummary)
+///
+/// Both csv files are synced after every append, before the lease of the run is dropped.
+///
+/// Taking runs loads the queue, pops them and saves it again with the runs leased to this
+/// process; finishing a run drops its lease, adds its samples to its point's summary and appends
+/// its result line, all under the queue lock. The lock serializes the processes (and a mutex the
+/// threads of one process, which fcntl locks do not tell apart).
+///
+/// The process that starts the queue fixes its schedule policy and summary interval; the others
+/// take them on when they join, so no process ranks the runs differently behind another's back.
+///
+/// The kernel drops a process's fcntl locks when it dies, however it dies, so a lease whose
+/// owner file is no longer locked belongs to a dead process: the next process to take runs puts
+/// such runs back at the front of the queue. With run checkpoints in the same directory (see
+/// BatchRunner::SetShared), a reclaimed run continues from its last checkpoint. A process that
+/// hangs without dying keeps its leases. As with BatchRunner's own checkpoints, a run that
+/// finished just before its process died may be reported twice, with identical results.
+///
+/// fcntl locks also work on NFS mounts with a lock manager, so processes on several machines can
+/// share a directory (each owner file names its host, since process ids repeat across hosts).
+
+#pragma once
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "base/vector.h"
+#include "binaryio.h"
+#include "queue-manager.h"
+
+namespace emp {
+
+class SharedQueue {
+   private:
+    static constexpr uint32_t STATE_MAGIC = 0x33514853;  // "SHQ3"
+
+    struct Lease {
+        std::string owner;  // Process that holds the run
+        RunInfo run;
+    };
+
+    /// Holds an exclusive fcntl lock on a whole file (waiting for it) while it lives. Taking the
+    /// lock can fail (with ENOLCK on an NFS mount without a lock manager, say), so check IsLocked
+    /// before touching anything it guards.
+    class FileLockGuard {
+       private:
+        int fd;
+        bool locked;
+
+       public:
+        FileLockGuard(int _fd) : fd(_fd), locked(SetLock(fd, F_WRLCK, F_SETLKW)) { }
+        ~FileLockGuard() {
+            if (locked) SetLock(fd, F_UNLCK, F_SETLK);
+        }
+        bool IsLocked() const { return locked; }
+    };
+
+    QueueManager& queue;
+    std::string dir;
+    std::string owner;       // This process, as HOST-PID
+    int lock_fd = -1;        // queue.lock
+    int owner_fd = -1;       // This process's owner file, locked while it lives
+    std::mutex mutex;        // Keeps the threads of this process out of each other's way
+    std::map<size_t, Lease> leases;  // Leased runs, by id (as last loaded)
+    double poll_seconds = 1.0;       // How long to wait before looking for reclaimable runs again
+    std::string error;               // Why the queue could not be used, empty while it can
+
+    static bool SetLock(int fd, short type, int command) {
+        struct flock lock = {};
+        lock.l_type = type;
+        lock.l_whence = SEEK_SET;
+        while (fcntl(fd, command, &lock) == -1) {
+            if (errno != EINTR) return false;
+        }
+        return true;
+    }
+
+    std::string StateName() const { return dir + "/queue.state"; }
+    std::string OwnerName(const std::string& name) const { return dir + "/owner-" + name + ".lock"; }
+
+    /// Whether the process named owner is still alive, i.e. still holds its owner file's lock.
+    bool OwnerAlive(const std::string& name) const {
+        const int fd = open(OwnerName(name).c_str(), O_RDWR);
+        if (fd == -1) return false;
+        struct flock lock = {};
+        lock.l_type = F_WRLCK;
+        lock.l_whence = SEEK_SET;
+        const bool alive = fcntl(fd, F_GETLK, &lock) == 0 && lock.l_type != F_UNLCK;
+        close(fd);
+        return alive;
+    }
+
+    // The functions below, up to the public section, need the queue lock to be held.
+
+    /// Records why the queue cannot be used (see GetError).
+    /// @return false, for the caller to return
+    bool Fail(const std::string& message) {
+        if (error.empty()) error = message;
+        return false;
+    }
+
+    /// @return false if file_lock does not hold the queue lock (see GetError)
+    bool CheckLocked(const FileLockGuard& file_lock) {
+        return file_lock.IsLocked() || Fail("cannot lock " + dir + "/queue.lock: " + std::strerror(errno));
+    }
+
+    /// Reads the queue and leases from queue.state. When joining, this process takes on the
+    /// queue's schedule policy and summary interval; after that (while workers may be reading
+    /// them) they are left alone, as every process has the same ones.
+    /// @return false if there is no complete state to read (see GetError)
+    bool LoadState(bool joining = false) {
+        leases.clear();
+        std::ifstream is(StateName(), std::ios::binary);
+        if (!is) return Fail("cannot open " + StateName());
+        uint32_t magic = 0;
+        uint64_t num_leases = 0;
+        if (!ReadBinary(is, magic) || magic != STATE_MAGIC || !ReadBinary(is, num_leases)) {
+            return Fail(StateName() + " is not a queue state this version can read");
+        }
+        for (uint64_t i = 0; i < num_leases; i++) {
+            Lease lease;
+            if (!ReadBinary(is, lease.owner) || !QueueManager::LoadRun(is, lease.run)) {
+                return Fail(StateName() + " is cut short");
+            }
+            leases[lease.run.id] = lease;
+        }
+        SchedulePolicy policy;
+        if (!queue.LoadQueue(is, !joining, policy)) return Fail(StateName() + " is cut short");
+        if (joining) queue.SetSchedule(policy);
+        return true;
+    }
+
+    /// Writes the queue and leases to queue.state.
+    /// @return false if it could not be written (see GetError)
+    bool SaveState() {
+        const bool saved = WriteFileAtomic(StateName(), [this](std::ostream& os) {
+            WriteBinary(os, STATE_MAGIC);
+            WriteBinary<uint64_t>(os, leases.size());
+            for (const auto& p : leases) {
+                WriteBinary(os, p.second.owner);
+                QueueManager::SaveRun(os, p.second.run);
+            }
+            queue.SaveQueue(os);
+        });
+        return saved || Fail("cannot write " + StateName());
+    }
+
+    /// Puts the runs of every dead process back at the front of the queue (this process's own
+    /// name counts as dead when stale is set, for leases left by an earlier process that had
+    /// the same id).
+    /// @return how many runs were reclaimed
+    size_t Reclaim(bool stale = false) {
+        std::map<std::string, bool> alive;  // By owner
+        alive[owner] = !stale;
+        emp::vector<RunInfo> reclaimed;
+        for (auto it = leases.begin(); it != leases.end();) {
+            const std::string& name = it->second.owner;
+            if (!alive.count(name)) alive[name] = OwnerAlive(name);
+            if (alive[name]) {
+                ++it;
+                continue;
+            }
+            reclaimed.push_back(it->second.run);
+            it = leases.erase(it);
+        }
+        // Returned in reverse so they are taken again in id order.
+        for (size_t i = reclaimed.size(); i-- > 0;) queue.ReturnRun(reclaimed[i]);
+        for (const auto& p : alive) {
+            if (!p.second && p.first != owner) std::remove(OwnerName(p.first).c_str());
+        }
+        return reclaimed.size();
+    }
+
+    /// Appends text to a file with a single write, so a crash leaves no partial line, and syncs
+    /// it to disk before returning.
+    /// @return false if the text could not be written (see GetError)
+    bool AppendFile(const std::string& filename, const std::string& text) {
+        const int fd = open(filename.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+        if (fd == -1) return Fail("cannot open " + filename);
+        const bool written = write(fd, text.data(), text.size()) == (ssize_t)text.size() && fsync(fd) == 0;
+        const bool created = SyncDirectory(filename);  // In case the append created it
+        if (close(fd) != 0 || !written || !created) return Fail("cannot write " + filename);
+        return true;
+    }
+
+   public:
+    /// Works on the queue kept in _dir (which must exist), through _queue as this process's copy.
+    SharedQueue(QueueManager& _queue, const std::string& _dir) : queue(_queue), dir(_dir) {
+        char host[256] = "";
+        gethostname(host, sizeof(host) - 1);
+        owner = std::string(host) + "-" + std::to_string(getpid());
+    }
+
+    ~SharedQueue() {
+        if (owner_fd != -1) {
+            std::remove(OwnerName(owner).c_str());
+            close(owner_fd);
+        }
+        if (lock_fd != -1) close(lock_fd);
+    }
+
+    SharedQueue(const SharedQueue&) = delete;
+    SharedQueue& operator=(const SharedQueue&) = delete;
+
+    const std::string& GetDir() const { return dir; }
+    const std::string& GetOwner() const { return owner; }
+    std::string GetResultsName() const { return dir + "/results.csv"; }
+    std::string GetSummaryName() const { return dir + "/summary.csv"; }
+
+    /// Sets how long a process with nothing to take waits before looking again (for runs of
+    /// processes that died).
+    void SetPollSeconds(double seconds) { poll_seconds = seconds; }
+
+    /// Why the queue could not be read or written, or empty if it always could. Once it is set,
+    /// TakeRun returns false as if the queue were done, so callers check it when they stop.
+    std::string GetError() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return error;
+    }
+
+    /// Opens the directory and joins its queue, or, if it has none yet, starts it with the runs
+    /// in this process's queue (writing results_header to the results file).
+    /// @param created set to whether this process started the queue
+    /// @return false if the directory cannot be used or holds an unreadable queue (see GetError)
+    bool Join(const std::string& results_header, bool& created) {
+        lock_fd = open((dir + "/queue.lock").c_str(), O_RDWR | O_CREAT, 0644);
+        owner_fd = open(OwnerName(owner).c_str(), O_RDWR | O_CREAT, 0644);
+        if (lock_fd == -1 || owner_fd == -1 || !SetLock(owner_fd, F_WRLCK, F_SETLK)) {
+            return Fail("cannot lock files in " + dir);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        FileLockGuard file_lock(lock_fd);
+        if (!CheckLocked(file_lock)) return false;
+        struct stat info;
+        created = stat(StateName().c_str(), &info) != 0;
+        if (created) {
+            leases.clear();
+            std::ostringstream summary_header;
+            QueueManager::WriteSummaryHeader(summary_header);
+            return AppendFile(GetResultsName(), results_header) && AppendFile(GetSummaryName(), summary_header.str()) &&
+                   SaveState();
+        }
+        if (!LoadState(true)) return false;
+        if (Reclaim(true)) return SaveState();
+        return true;
+    }
+
+    /// Leases the next run to this process. If the queue is empty while other processes still
+    /// hold runs, waits for them: should any of them die, its runs are taken over.
+    /// @return false once there is nothing left to take, or if the queue cannot be read or
+    /// written (GetError then says why)
+    bool TakeRun(RunInfo& run) {
+        while (true) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (error.size()) return false;
+                FileLockGuard file_lock(lock_fd);
+                if (!CheckLocked(file_lock) || !LoadState()) return false;
+                const bool reclaimed = Reclaim() > 0;
+                if (queue.PopRun(run)) {
+                    leases[run.id] = {owner, run};
+                    return SaveState();  // A run it could not lease is not this process's to run.
+                }
+                if (reclaimed && !SaveState()) return false;
+                bool others = false;
+                for (const auto& p : leases) others |= p.second.owner != owner;
+                if (!others) return false;
+            }
+            std::this_thread::sleep_for(std::chrono::duration<double>(poll_seconds));
+        }
+    }
+
+    /// Records a leased run as finished: drops its lease, adds its summary samples (see
+    /// QueueManager::AddRunSamples) and appends result_line to the results file, and the
+    /// summary of its point to the summary file if that was the point's last replicate.
+    /// @return false if this process no longer holds the run (nothing is recorded then), or if
+    /// the queue or the csv files cannot be read or written (either way, GetError says why)
+    bool Finish(const RunInfo& run, const emp::vector<double>& samples, const std::string& result_line) {
+        std::lock_guard<std::mutex> lock(mutex);
+        FileLockGuard file_lock(lock_fd);
+        if (!CheckLocked(file_lock) || !LoadState()) return false;
+        auto lease = leases.find(run.id);
+        if (lease == leases.end() || lease->second.owner != owner) {
+            return Fail("run " + std::to_string(run.id) + " is no longer leased to " + owner);
+        }
+        leases.erase(lease);
+        const bool point_done = queue.AddRunSamples(run, samples);
+        // The lease is kept on disk until the lines are; a run whose lines are lost is run again.
+        if (!AppendFile(GetResultsName(), result_line)) return false;
+        if (point_done) {
+            std::ostringstream summary;
+            queue.WriteSummary(summary, run.point_id);
+            if (!AppendFile(GetSummaryName(), summary.str())) return false;
+            queue.RemoveSummary(run.point_id);
+        }
+        return SaveState();
+    }
+
+    /// How many runs are queued and how many are leased, as of now.
+    /// @return false if the queue cannot be read (see GetError)
+    bool GetCounts(size_t& queued, size_t& leased) {
+        std::lock_guard<std::mutex> lock(mutex);
+        FileLockGuard file_lock(lock_fd);
+        if (!CheckLocked(file_lock) || !LoadState()) return false;
+        queued = queue.RunsRemaining();
+        leased = leases.size();
+        return true;
+    }
+};
+
+}  // namespace emp
@@ -1,27 +1,172 @@
 #pragma once
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
 #include <functional>
+#include <istream>
+#include <memory>
+#include <ostream>
 #include <queue>
+#include <sstream>
 #include <string>
 #include <unordered_map>
 #include <utility>
 
 #include "base/vector.h"
+#include "binaryio.h"
 #include "config/SettingConfig.h"
-#include "tools/Random.h"
+#include "counterrandom.h"
+#include "pdkernels.h"
+#include "perfcounters.h"
+#include "recorder.h"
+#include "threadpool.h"
 #include "tools/math.h"
 #include "web/Div.h"
 #include "web/web.h"
 
 namespace emp {
 
-struct Org {
-    double x;
-    double y;
-    bool coop;
-    double fitness;
+/// Why a run stopped (NONE while it is still going).
+enum class StopReason : uint8_t { NONE, EPOCHS, FIXATION, STEADY, TIME_BUDGET };
 
-    emp::vector<size_t> neighbors;
+inline const char* StopReasonName(StopReason reason) {
+    switch (reason) {
+        case StopReason::EPOCHS: return "epochs";
+        case StopReason::FIXATION: return "fixation";
+        case StopReason::STEADY: return "steady";
+        case StopReason::TIME_BUDGET: return "time_budget";
+        default: return "none";
+    }
+}
+
+/// Conditions for ending a run before it reaches E epochs; all are off by default.
+struct StopConditions {
+    bool fixation = false;      // Stop once every organism has the same strategy
+    double steady_epsilon = 0;  // Stop once the cooperator fraction has stayed in a range no wider
+    size_t steady_window = 0;   //   than steady_epsilon for steady_window epochs (off if the window is 0)
+    double time_budget = 0;     // Stop after this many seconds of wall-clock time (off if 0)
+
+    /// Reads a spec such as "fixation; steady=0.01:500; budget=60" (steady=EPSILON:WINDOW, budget
+    /// in seconds); entries not given stay off.
+    /// @return false if the spec could not be read
+    bool Parse(const std::string& spec) {
+        *this = StopConditions();
+        std::stringstream entries(spec);
+        std::string entry;
+        while (std::getline(entries, entry, ';')) {
+            const size_t first = entry.find_first_not_of(" \t\n");
+            if (first == std::string::npos) continue;
+            entry = entry.substr(first, entry.find_last_not_of(" \t\n") + 1 - first);
+            if (entry == "fixation") {
+                fixation = true;
+                continue;
+            }
+            const size_t eq_pos = entry.find('=');
+            if (eq_pos == std::string::npos) return false;
+            const std::string name = entry.substr(0, eq_pos);
+            const std::string value = entry.substr(eq_pos + 1);
+            char* end = nullptr;
+            if (name == "steady") {
+                steady_epsilon = std::strtod(value.c_str(), &end);
+                if (end == value.c_str() || *end != ':') return false;
+                const char* window = end + 1;
+                steady_window = (size_t)std::strtoull(window, &end, 10);
+                if (end == window || steady_epsilon < 0.0) return false;
+            } else if (name == "budget") {
+                time_budget = std::strtod(value.c_str(), &end);
+                if (end == value.c_str() || time_budget < 0.0) return false;
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+/// The steady-state test of StopConditions: the lowest and highest cooperator fraction since the
+/// window began. When a fraction would widen the range past steady_epsilon the window starts over
+/// at that fraction, so a run is only called steady once every fraction of the last steady_window
+/// epochs lies within steady_epsilon of every other (it may stop later than the first such window).
+struct SteadyWindow {
+    double min_fraction = 0.0;
+    double max_fraction = 0.0;
+    size_t since = 0;  // Epoch the window began at
+
+    void Start(double fraction, size_t epoch) {
+        min_fraction = max_fraction = fraction;
+        since = epoch;
+    }
+
+    /// Adds the fraction at the end of epoch.
+    /// @return true once the fraction has been steady for stop.steady_window epochs
+    bool Add(double fraction, size_t epoch, const StopConditions& stop) {
+        const double lo = std::min(min_fraction, fraction), hi = std::max(max_fraction, fraction);
+        if (hi - lo > stop.steady_epsilon) {
+            Start(fraction, epoch);
+            return false;
+        }
+        min_fraction = lo;
+        max_fraction = hi;
+        return epoch - since >= stop.steady_window;
+    }
+};
+
+/// Parameters for one SimplePDWorld run, read once from a SettingConfig so runs can share them.
+struct PDParams {
+    double r = 0.02;   // Neighborhood radius
+    double u = 0.175;  // cost / benefit ratio
+    size_t N = 6400;   // Population size
+    size_t E = 5000;   // How many epochs should a popuilation run for?
+    StopConditions stop;  // When to end a run early (not a setting; see QueueManager::SetStopConditions)
+
+    /// Reads the r_value, u_value, N_value and E_value settings.
+    static PDParams FromConfig(const SettingConfig& config) {
+        PDParams params;
+        params.r = config.GetValue<double>("r_value");
+        params.u = config.GetValue<double>("u_value");
+        params.N = config.GetValue<size_t>("N_value");
+        params.E = config.GetValue<size_t>("E_value");
+        return params;
+    }
+
+    /// Setting names SetValue and GetValue accept.
+    static const emp::vector<std::string>& SettingNames() {
+        static const emp::vector<std::string> names = {"r_value", "u_value", "N_value", "E_value"};
+        return names;
+    }
+
+    /// Sets a parameter by its setting name.
+    /// @return false if name is not a SimplePDWorld setting
+    bool SetValue(const std::string& name, double value) {
+        if (name == "r_value") r = value;
+        else if (name == "u_value") u = value;
+        else if (name == "N_value") N = (size_t)std::llround(value);
+        else if (name == "E_value") E = (size_t)std::llround(value);
+        else return false;
+        return true;
+    }
+
+    /// Reads a parameter by its setting name.
+    /// @return false if name is not a SimplePDWorld setting
+    bool GetValue(const std::string& name, double& value) const {
+        if (name == "r_value") value = r;
+        else if (name == "u_value") value = u;
+        else if (name == "N_value") value = (double)N;
+        else if (name == "E_value") value = (double)E;
+        else return false;
+        return true;
+    }
+
+    /// Rough work of a full run, for scheduling: each of E epochs updates N organisms, and each
+    /// update looks at a neighborhood of about pi r^2 N organisms (the world is a unit torus).
+    double EstimateCost() const {
+        const double area = std::min(M_PI * r * r, 1.0);
+        const double neighbors = area * (double)(N ? N - 1 : 0);
+        return (double)E * (double)N * (1.0 + neighbors);
+    }
 };
 
 // Create a class to maintain a simple Prisoner's Dilema world.
@@ -35,12 +180,89 @@ class SimplePDWorld {
     size_t num_runs;  // How many runs should we do?
     bool use_ave;     // Use the average payoff for fitness instead if the total.
 
-    emp::Random random;  // All-purpose random-number generator
+    emp::CounterRandom random;  // All-purpose random-number generator
     size_t epoch;        // What epoch are we currently on?
 
     // Calculations we'll need later.
     double r_sqr;  // r squared (for comparisons)
-    emp::vector<Org> pop;
+
+    // Population, stored as one array per trait so each loop only touches the bytes it needs.
+    emp::vector<double> pos_x;        // x-coordinate of each organism
+    emp::vector<double> pos_y;        // y-coordinate of each organism
+    emp::vector<uint64_t> coop_bits;  // Strategy of each organism, one bit per organism (1 = cooperate)
+    emp::vector<double> fitness;      // Current payoff of each organism
+
+    // Population-wide aggregates, kept current as Setup and Repro change the population.
+    size_t num_coop;          // How many cooperators are there right now?
+    double fitness_sum;       // Sum of fitness across the population
+    size_t epoch_flips;       // Strategy changes so far in the epoch in progress
+    size_t last_epoch_flips;  // Strategy changes during the most recent full epoch
+
+    // Neighbor lists for the whole population in compressed sparse row form: the neighbors of
+    // organism i are neighbor_ids[neighbor_start[i]] through neighbor_ids[neighbor_start[i+1] - 1].
+    // Ids fit in 32 bits, but the offsets do not: N = 4M at r = 0.01 has over 2^32 entries.
+    emp::vector<uint64_t> neighbor_start;
+    emp::vector<uint32_t> neighbor_ids;
+
+    // Neighborhood counts, kept current by delta as strategies flip. Each organism's payoff only
+    // depends on its count of cooperating neighbors (and its degree), so these give every
+    // payoff, and the total payoff of an organism's cooperating and defecting neighbors, without
+    // scanning any neighbor list.
+    emp::vector<uint32_t> coop_nbrs;      // Cooperating neighbors of each organism
+    emp::vector<uint64_t> sum_c_coop;     // Sum of coop_nbrs over each organism's cooperating neighbors
+    emp::vector<uint64_t> sum_c_all;      // Sum of coop_nbrs over all of each organism's neighbors
+    emp::vector<uint64_t> sum_deg_coop;   // Sum of degrees of each organism's cooperating neighbors
+    emp::vector<uint64_t> sum_deg_all;    // Sum of degrees of all of each organism's neighbors (fixed)
+
+    SeriesRecorder* recorder = nullptr;  // Gets the state after every epoch, if set
+
+    // Early stopping (see StopConditions and SteadyWindow).
+    StopConditions stop;
+    StopReason stop_reason = StopReason::NONE;
+    SteadyWindow steady;
+    std::chrono::steady_clock::time_point start_time;  // When this process started (or resumed) the run
+
+    // Event-driven updating (optional; see SetEventDriven). An organism is active if at least one
+    // of its neighbors has the other strategy; only an active organism can change strategy in Repro.
+    static constexpr uint32_t NOT_ACTIVE = (uint32_t)-1;
+    bool event_driven = false;
+    emp::vector<uint32_t> active_list;  // Active organisms, in no particular order
+    emp::vector<uint32_t> active_pos;   // Index of each organism in active_list, or NOT_ACTIVE
+
+    WorldPerf perf;  // Hot-path counters (only counted when built with QM_PERF=1; see perfcounters.h)
+
+    /// Where Repro keeps its running totals and draws its random numbers: the world's own for the
+    /// serial update, or one tile's for a parallel epoch (see ParallelEpoch).
+    struct Tally {
+        CounterRandom& random;
+        size_t& num_coop;
+        double& fitness_sum;
+        size_t& epoch_flips;
+        WorldPerf& perf;
+    };
+    Tally OwnTally() { return {random, num_coop, fitness_sum, epoch_flips, perf}; }
+
+    /// One tile's stream and totals during a parallel epoch; the totals are changes, added to the
+    /// world's (in tile order) once the epoch is done.
+    struct TileState {
+        CounterRandom random;
+        size_t num_coop = 0;  // Wraps around when the tile loses cooperators
+        double fitness_sum = 0.0;
+        size_t epoch_flips = 0;
+        WorldPerf perf;
+
+        Tally GetTally() { return {random, num_coop, fitness_sum, epoch_flips, perf}; }
+    };
+
+    // Parallel updating (optional; see SetParallel). The torus is cut into tiles_per_side^2
+    // square tiles; the organisms of tile k are tile_orgs[tile_start[k]] through
+    // tile_orgs[tile_start[k + 1] - 1], in id order.
+    size_t parallel_tiles = 0;  // Tiles per side asked for (0 for the serial update)
+    size_t tiles_per_side = 0;  // Tiles per side in use (0 when the serial update is used)
+    emp::vector<uint32_t> tile_start;
+    emp::vector<uint32_t> tile_orgs;
+    emp::vector<TileState> tile_states;
+    std::shared_ptr<ThreadPool> pool;  // Shared by copies of the world
 
     // Prisoner's Dilema payout table...
     double payoff_CC;
@@ -49,22 +271,75 @@ class SimplePDWorld {
     double payoff_DD;
 
     // Helper functions
-    void CalcFitness(size_t id);
+    void SetupPayoffs();
+    void BuildNeighbors();
+    void BuildCounts();
+    void FlipCounts(size_t id, Tally& tally);
+    void CalcFitness(size_t id, Tally& tally);
+    void CalcFitness(size_t id) {
+        Tally tally = OwnTally();
+        CalcFitness(id, tally);
+    }
     void Repro();
+    void ReproAt(size_t id, Tally& tally);
+    void ReproAt(size_t id) {
+        Tally tally = OwnTally();
+        ReproAt(id, tally);
+    }
+    void CheckStop();
+    void BuildActive();
+    void UpdateActive(size_t id);
+    void FlipActive(size_t id);
+    void EventEpoch();
+    void BuildTiles();
+    void ParallelEpoch();
 
    public:
-    SimplePDWorld(double _r = 0.02, double _u = 0.175, size_t _N = 6400, size_t _E = 5000, bool _ave = false, int seed = 0)
+    SimplePDWorld(double _r = 0.02, double _u = 0.175, size_t _N = 6400, size_t _E = 5000, bool _ave = false, uint64_t seed = 0)
         : num_runs(10), random(seed) {
         Setup(_r, _u, _N, _E, _ave);  // Call Setup since we a starting a new population.
     }
 
-    const emp::vector<Org>& GetPop() const { return pop; }
     double GetR() const { return r; }
     double GetU() const { return u; }
     size_t GetN() const { return N; }
     size_t GetE() const { return E; }
     size_t GetNumRuns() const { return num_runs; }
     size_t GetEpoch() const { return epoch; }
+    size_t GetNumNeighbors(size_t id) const { return neighbor_start[id + 1] - neighbor_start[id]; }
+
+    double GetX(size_t id) const { return pos_x[id]; }
+    double GetY(size_t id) const { return pos_y[id]; }
+    // Atomic, since a parallel epoch flips bits of other organisms in the same word (relaxed: on
+    // common hardware this is an ordinary load).
+    bool IsCoop(size_t id) const { return (__atomic_load_n(&coop_bits[id >> 6], __ATOMIC_RELAXED) >> (id & 63)) & 1; }
+    double GetFitness(size_t id) const { return fitness[id]; }
+    double GetMeanFitness() const { return N ? fitness_sum / (double)N : 0.0; }
+    size_t GetEpochFlips() const { return last_epoch_flips; }
+    size_t GetNumActive() const { return active_list.size(); }
+    size_t GetNumCoopNeighbors(size_t id) const { return coop_nbrs[id]; }
+    /// Neighbors of id with the other strategy.
+    size_t GetNumOtherNeighbors(size_t id) const {
+        return IsCoop(id) ? GetNumNeighbors(id) - coop_nbrs[id] : coop_nbrs[id];
+    }
+    StopReason GetStopReason() const { return stop_reason; }
+    bool IsStopped() const { return stop_reason != StopReason::NONE; }
+
+    /// Counters since the last Setup or TakePerf (all zero unless built with QM_PERF=1).
+    const WorldPerf& GetPerf() const { return perf; }
+    /// Returns the counters and starts them over, so a caller can add up several worlds' work.
+    WorldPerf TakePerf() {
+        const WorldPerf out = perf;
+        perf = WorldPerf();
+        return out;
+    }
+
+    /// Sets a strategy bit only; Setup uses it before any counts exist. (Changing strategies
+    /// after Setup is Repro's job, since it also keeps the counts and payoffs current.)
+    void SetCoop(size_t id, bool coop) {
+        if (coop) coop_bits[id >> 6] |= (uint64_t)1 << (id & 63);
+        else coop_bits[id >> 6] &= ~((uint64_t)1 << (id & 63));
+    }
 
     void SetR(double _r) { r = _r; }
     void SetU(double _u) { u = _u; }
@@ -74,6 +349,66 @@ class SimplePDWorld {
 
     void UseAve(bool _in = true) { use_ave = _in; }
 
+    /// Conditions for Run to stop early; they persist across Setup (except Setup from PDParams,
+    /// which takes them from the parameters).
+    void SetStopConditions(const StopConditions& _stop) { stop = _stop; }
+
+    /// Switches event-driven updating on or off; the setting persists across Setup and LoadState.
+    /// Instead of picking N organisms per epoch and updating each, an event-driven epoch only picks
+    /// among active organisms, skipping ahead by a geometrically distributed number of picks that
+    /// would have landed on inactive ones (which can never change). The process has the same
+    /// distribution as the default one, but consumes random numbers differently, so a given seed
+    /// gives a different (equally likely) trajectory in each mode.
+    void SetEventDriven(bool _in = true) {
+        event_driven = _in;
+        if (event_driven) BuildActive();
+        else {
+            active_list.clear();
+            active_pos.clear();
+        }
+    }
+    bool IsEventDriven() const { return event_driven; }
+
+    /// Switches the parallel update on (with tiles tiles per side, run on threads threads; 0 for
+    /// one per hardware thread) or off (tiles = 0); the setting persists across Setup and LoadState.
+    ///
+    /// The torus is cut into square tiles, as many per side as asked for, but an even number and
+    /// wider than 4r (so fewer for large r; below two per side the serial update is used,
+    /// see GetTilesPerSide). The tiles are colored like a 2x2 checkerboard repeated across the
+    /// torus, and an epoch runs the four colors in turn. Within a color's turn, each tile of that
+    /// color does as many Repro calls as it has organisms, each on one of its own organisms picked
+    /// at random, and the tiles run at the same time. A Repro call changes nothing further than
+    /// 2r away, and tiles of the same color are at least 4r apart, so concurrent calls never touch
+    /// the same organism's state.
+    ///
+    /// Compared with the serial update, which picks each of N organisms per epoch from the whole
+    /// population, every organism still expects one update per epoch, but updates are grouped
+    /// by tile and by color (a block-sequential rather than a fully random order), and a tile's
+    /// updates come from its own random stream. A run is reproducible for a given seed and tile
+    /// count, whatever the number of threads, but is a different (not equally likely) trajectory
+    /// from a serial run with the same seed. The event-driven update takes precedence.
+    void SetParallel(size_t tiles, size_t threads = 0) {
+        parallel_tiles = tiles;
+        if (tiles == 0) pool.reset();
+        else if (!pool || pool->GetNumThreads() != (threads ? threads : std::thread::hardware_concurrency())) {
+            pool = std::make_shared<ThreadPool>(threads);
+        }
+        BuildTiles();
+    }
+    /// Tiles per side the parallel update uses (0 when it is off or r is too large for two).
+    size_t GetTilesPerSide() const { return tiles_per_side; }
+
+    /// Sends the state after every epoch (and the current state, right away) to _recorder; pass
+    /// nullptr to stop. The recorder is not owned by the world and persists across Setup.
+    void SetRecorder(SeriesRecorder* _recorder) {
+        recorder = _recorder;
+        RecordState();
+    }
+
+    void RecordState() {
+        if (recorder) recorder->Record(epoch, num_coop, N - num_coop, GetMeanFitness(), last_epoch_flips);
+    }
+
     void Setup(double _r = 0.02, double _u = 0.0025, size_t _N = 6400, size_t _E = 5000, bool _ave = false) {
         // Store the input values.
         r = _r;
@@ -81,159 +416,480 @@ class SimplePDWorld {
         N = _N;
         E = _E, use_ave = _ave;
         epoch = 0;
+        perf = WorldPerf();
+        QM_PERF_TIME(perf.setup_ns);
 
         // Calculations we'll need later.
         r_sqr = r * r;  // r squared (for comparisons)
-        pop.resize(N);
-
-        // Setup the payout matric.
-        payoff_CC = 1.0;
-        payoff_CD = 0.0;
-        payoff_DC = 1.0 + u;
-        payoff_DD = u;
+        pos_x.resize(N);
+        pos_y.resize(N);
+        coop_bits.assign((N + 63) / 64, 0);  // Padding bits in the last word must stay zero.
+        fitness.assign(N, 0.0);
+        num_coop = 0;
+        fitness_sum = 0.0;
+        epoch_flips = 0;
+        last_epoch_flips = 0;
+        stop_reason = StopReason::NONE;
+        start_time = std::chrono::steady_clock::now();
+
+        SetupPayoffs();
 
         // Initialize each organism
-        for (Org& org : pop) {
-            org.x = random.GetDouble(1.0);
-            org.y = random.GetDouble(1.0);
-            org.coop = random.P(0.5);
-            org.neighbors.resize(0);
+        for (size_t id = 0; id < N; id++) {
+            pos_x[id] = random.GetDouble(1.0);
+            pos_y[id] = random.GetDouble(1.0);
+            const bool coop = random.P(0.5);
+            SetCoop(id, coop);
+            if (coop) num_coop++;
         }
 
-        // Determine if pairs of organisms are neighbors;
-        // @CAO: Can speed up by using Surface2D.
-        for (size_t i = 1; i < N; i++) {
-            for (size_t j = 0; j < i; j++) {
-                Org& org1 = pop[i];
-                Org& org2 = pop[j];
-                double x_dist = emp::Abs(org1.x - org2.x);
-                if (x_dist > (1.0 - x_dist)) x_dist = 1.0 - x_dist;
-                double y_dist = emp::Abs(org1.y - org2.y);
-                if (x_dist > (1.0 - x_dist)) x_dist = 1.0 - x_dist;
-                double dist_sqr = x_dist * x_dist + y_dist * y_dist;
-
-                // Test if this pair are within neighbor radius...
-                if (dist_sqr < r_sqr) {
-                    org1.neighbors.push_back(j);
-                    org2.neighbors.push_back(i);
-                }
-            }
-        }
+        // Determine which pairs of organisms are neighbors.
+        BuildNeighbors();
+        BuildCounts();
+        BuildTiles();
 
-        // Calculate the initial fitness for each organism in the population.
-        for (size_t id = 0; id < N; id++) {
-            CalcFitness(id);
-        }
+        // Calculate the initial fitness for each organism in the population (as CalcFitness would).
+        pdkernels::ComputeFitness(coop_nbrs.data(), neighbor_start.data(), coop_bits.data(),
+                                  {payoff_CC, payoff_CD, payoff_DC, payoff_DD}, use_ave, fitness.data(), N);
+        for (size_t id = 0; id < N; id++) fitness_sum += fitness[id];
+        steady.Start(N ? (double)num_coop / (double)N : 0.0, 0);
+
+        if (event_driven) BuildActive();
+    }
+
+    void Setup(const PDParams& params) {
+        stop = params.stop;
+        Setup(params.r, params.u, params.N, params.E);
+    }
+
+    /// Starts a run from scratch on the random stream for seed, so its outcome depends only on
+    /// params and seed (not on what this world ran before).
+    void Setup(const PDParams& params, uint64_t seed) {
+        random.ResetSeed(seed);
+        Setup(params);
     }
 
     void Reset() { Setup(r, u, N, E); }
 
+    /// Runs up to steps epochs, or until a stop condition is met (see GetStopReason).
     void Run(size_t steps = -1) {
         if (steps > E) steps = E;
+        QM_PERF_TIME(perf.run_ns);
         // Run the organisms!
         size_t end_epoch = epoch + steps;
-        while (epoch < end_epoch) {
-            for (size_t o = 0; o < N; o++) Repro();
+        while (epoch < end_epoch && !IsStopped()) {
+            if (event_driven) EventEpoch();
+            else if (tiles_per_side) ParallelEpoch();
+            else for (size_t o = 0; o < N; o++) Repro();
+            last_epoch_flips = epoch_flips;
+            epoch_flips = 0;
             epoch++;
+            QM_PERF_COUNT(perf.epochs, 1);
+            RecordState();
+            CheckStop();
         }
     }
 
-    size_t CountCoop();
+    size_t CountCoop() const;
+    size_t RecountCoop() const;
     void PrintNeighborInfo(std::ostream& os);
+
+    // Checkpointing: a snapshot holds the parameters, population, random-number state and epoch.
+    // Neighbor lists are rebuilt from the positions on load, and the restored world continues
+    // exactly as the saved one would have.
+    void SaveState(std::ostream& os) const;
+    bool LoadState(std::istream& is);
 };
 
-// To calculate the fitness of an organism, have it play
-// against all its neighbors and take the average payout.
-void SimplePDWorld::CalcFitness(size_t id) {
-    Org& org = pop[id];
+// Setup the payout matric.
+void SimplePDWorld::SetupPayoffs() {
+    payoff_CC = 1.0;
+    payoff_CD = 0.0;
+    payoff_DC = 1.0 + u;
+    payoff_DD = u;
+}
+
+// Check the stop conditions at the end of an epoch.
+void SimplePDWorld::CheckStop() {
+    if (stop.fixation && (num_coop == 0 || num_coop == N)) {
+        stop_reason = StopReason::FIXATION;
+        return;
+    }
+    if (stop.steady_window && N && steady.Add((double)num_coop / (double)N, epoch, stop)) {
+        stop_reason = StopReason::STEADY;
+        return;
+    }
+    if (stop.time_budget > 0.0 &&
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count() >= stop.time_budget) {
+        stop_reason = StopReason::TIME_BUDGET;
+    }
+}
 
-    int C_count = 0;
-    int D_count = 0;
-    for (size_t n : org.neighbors) {
-        if (pop[n].coop)
-            C_count++;
-        else
-            D_count++;
+// Bin organisms into a uniform grid of cells at least r wide, so only the 3x3 block of cells
+// around each organism (wrapping on both axes) needs to be searched for neighbors.
+void SimplePDWorld::BuildNeighbors() {
+    size_t cells_per_side = (r > 0.0) ? (size_t)(1.0 / r) : 1;
+    while (cells_per_side > 1 && 1.0 / (double)cells_per_side < r) cells_per_side--;
+    // Never use more cells than organisms, and with fewer than three cells per side the 3x3 block
+    // would wrap onto itself; one cell covering the whole world is just as fast at that point.
+    cells_per_side = std::min(cells_per_side, (size_t)std::sqrt((double)N) + 1);
+    if (cells_per_side < 3) cells_per_side = 1;
+    const size_t num_cells = cells_per_side * cells_per_side;
+
+    auto cell_coord = [cells_per_side](double pos) {
+        size_t c = (size_t)(pos * (double)cells_per_side);
+        return (c < cells_per_side) ? c : cells_per_side - 1;
+    };
+
+    // Counting sort of organism ids by cell.
+    emp::vector<size_t> org_cell(N);
+    emp::vector<size_t> cell_start(num_cells + 1, 0);
+    for (size_t i = 0; i < N; i++) {
+        org_cell[i] = cell_coord(pos_y[i]) * cells_per_side + cell_coord(pos_x[i]);
+        cell_start[org_cell[i] + 1]++;
     }
+    for (size_t c = 0; c < num_cells; c++) cell_start[c + 1] += cell_start[c];
+    emp::vector<size_t> cell_orgs(N);
+    emp::vector<size_t> fill_pos(cell_start.begin(), cell_start.end() - 1);
+    for (size_t i = 0; i < N; i++) cell_orgs[fill_pos[org_cell[i]]++] = i;
+
+    // Reserve for the expected neighborhood size (pi r^2 N) so the id array rarely regrows.
+    emp_assert(N < UINT32_MAX, "Population too large for 32-bit neighbor ids", N);
+    neighbor_start.resize(N + 1);
+    neighbor_ids.resize(0);
+    neighbor_ids.reserve((size_t)(1.1 * 3.1416 * r_sqr * (double)N * (double)N) + N);
+    neighbor_start[0] = 0;
+
+    for (size_t i = 0; i < N; i++) {
+        const size_t cx = org_cell[i] % cells_per_side;
+        const size_t cy = org_cell[i] / cells_per_side;
+        const size_t span = (cells_per_side == 1) ? 1 : 3;
+
+        for (size_t dy = 0; dy < span; dy++) {
+            const size_t ny = (cy + cells_per_side + dy - (span / 2)) % cells_per_side;
+            for (size_t dx = 0; dx < span; dx++) {
+                const size_t nx = (cx + cells_per_side + dx - (span / 2)) % cells_per_side;
+                const size_t cell = ny * cells_per_side + nx;
+                for (size_t k = cell_start[cell]; k < cell_start[cell + 1]; k++) {
+                    const size_t j = cell_orgs[k];
+                    if (j == i) continue;
+                    double x_dist = emp::Abs(pos_x[i] - pos_x[j]);
+                    if (x_dist > (1.0 - x_dist)) x_dist = 1.0 - x_dist;
+                    double y_dist = emp::Abs(pos_y[i] - pos_y[j]);
+                    if (y_dist > (1.0 - y_dist)) y_dist = 1.0 - y_dist;
+                    double dist_sqr = x_dist * x_dist + y_dist * y_dist;
+
+                    // Test if this pair are within neighbor radius...
+                    if (dist_sqr < r_sqr) neighbor_ids.push_back((uint32_t)j);
+                }
+            }
+        }
+
+        // Keep neighbors in id order (as the all-pairs scan produced) so runs are reproducible.
+        std::sort(neighbor_ids.begin() + neighbor_start[i], neighbor_ids.end());
+        neighbor_start[i + 1] = neighbor_ids.size();
+    }
+}
+
+// Count each organism's cooperating neighbors, and the sums over neighborhoods that Repro uses.
+void SimplePDWorld::BuildCounts() {
+    coop_nbrs.resize(N);
+    pdkernels::CountCoopNeighbors(neighbor_start.data(), neighbor_ids.data(), coop_bits.data(), coop_nbrs.data(), N);
+
+    sum_c_coop.assign(N, 0);
+    sum_c_all.assign(N, 0);
+    sum_deg_coop.assign(N, 0);
+    sum_deg_all.assign(N, 0);
+    for (size_t id = 0; id < N; id++) {
+        const uint32_t* nbr_end = neighbor_ids.data() + neighbor_start[id + 1];
+        for (const uint32_t* n = neighbor_ids.data() + neighbor_start[id]; n < nbr_end; n++) {
+            const uint64_t degree = GetNumNeighbors(*n);
+            sum_c_all[id] += coop_nbrs[*n];
+            sum_deg_all[id] += degree;
+            if (IsCoop(*n)) {
+                sum_c_coop[id] += coop_nbrs[*n];
+                sum_deg_coop[id] += degree;
+            }
+        }
+    }
+}
+
+// id has just changed strategy: update the counts of its neighbors, and the neighborhood sums of
+// their neighbors (including those of id's own neighborhood).
+void SimplePDWorld::FlipCounts(size_t id, Tally& tally) {
+    const bool coop = IsCoop(id);
+    const uint64_t delta = coop ? 1 : (uint64_t)-1;  // Unsigned wraparound subtracts one.
+    const uint64_t degree = GetNumNeighbors(id);
+    const uint32_t* nbr_begin = neighbor_ids.data() + neighbor_start[id];
+    const uint32_t* nbr_end = neighbor_ids.data() + neighbor_start[id + 1];
+    uint64_t scanned = degree;  // Counted here rather than in the loop, which stores through uint64_t arrays
+    for (const uint32_t* n = nbr_begin; n < nbr_end; n++) {
+        // id joins (or leaves) the cooperating part of n's neighborhood...
+        sum_c_coop[*n] += delta * coop_nbrs[id];
+        sum_deg_coop[*n] += delta * degree;
+
+        // ...and n gains (or loses) a cooperating neighbor, which n's own neighbors see.
+        coop_nbrs[*n] += (uint32_t)delta;
+        const bool n_coop = IsCoop(*n);
+        const uint32_t* m_end = neighbor_ids.data() + neighbor_start[*n + 1];
+        const uint32_t* m_begin = neighbor_ids.data() + neighbor_start[*n];
+        scanned += (uint64_t)(m_end - m_begin);
+        for (const uint32_t* m = m_begin; m < m_end; m++) {
+            sum_c_all[*m] += delta;
+            if (n_coop) sum_c_coop[*m] += delta;
+        }
+    }
+    QM_PERF_COUNT(tally.perf.neighbors_scanned, scanned);
+    (void)scanned;
+    (void)tally;
+}
+
+// To calculate the fitness of an organism, have it play
+// against all its neighbors and take the average payout.
+void SimplePDWorld::CalcFitness(size_t id, Tally& tally) {
+    QM_PERF_COUNT(tally.perf.calc_fitness_calls, 1);
+    const size_t C_count = coop_nbrs[id];
+    const size_t D_count = GetNumNeighbors(id) - C_count;
 
     double C_value = payoff_CC;
     double D_value = payoff_CD;
 
-    if (!org.coop) {
+    if (!IsCoop(id)) {
         C_value = payoff_DC;
         D_value = payoff_DD;
     }
 
     double total_C = C_value * (double)C_count;
     double total_D = D_value * (double)D_count;
-    org.fitness = total_C + total_D;
+    double new_fitness = total_C + total_D;
+
+    // An organism with no neighbors plays no games, so its average payoff is zero.
+    if (use_ave && C_count + D_count > 0) new_fitness /= (double)(C_count + D_count);
 
-    if (use_ave) org.fitness /= (double)org.neighbors.size();
+    tally.fitness_sum += new_fitness - fitness[id];
+    fitness[id] = new_fitness;
 }
 
 // Reproduce into a single, random cell.
 void SimplePDWorld::Repro() {
-    size_t id = random.GetUInt(N);
-    Org& org = pop[id];
-    bool start_coop = org.coop;
-
-    // Determine the total fitness of neighbors.
-    double total_fitness = 0;
-    for (size_t n : org.neighbors) {
-        total_fitness += pop[n].fitness;
-    }
-
-    // If neighbor fitnesses are non-zero, choose one of them.
-    if (total_fitness > 0) {
-        // Include the focal organism in the pool
-        double choice = random.GetDouble(total_fitness + org.fitness);
-
-        // If we aren't keeping the focal organism, we have to pick
-        if (choice < total_fitness) {
-            for (size_t n : org.neighbors) {
-                if (choice < pop[n].fitness) {
-                    org.coop = pop[n].coop;  // Copy strategy of winner!
-                    break;
+    ReproAt(random.GetUInt(N));
+}
+
+// Reproduce into cell id: it keeps its own strategy, or copies a neighbor's, with probability in
+// proportion to fitness. Only the strategy of the winner matters, so with total payoffs the
+// cached neighborhood sums give the chance of each strategy directly; average payoffs are not
+// linear in the counts, and fall back to walking the neighbors.
+void SimplePDWorld::ReproAt(size_t id, Tally& tally) {
+    const bool start_coop = IsCoop(id);
+    bool new_coop = start_coop;
+
+    const uint32_t* nbr_begin = neighbor_ids.data() + neighbor_start[id];
+    const uint32_t* nbr_end = neighbor_ids.data() + neighbor_start[id + 1];
+    QM_PERF_COUNT(tally.perf.repro_calls, 1);
+
+    if (!use_ave) {
+        // Cooperating neighbors with c cooperating neighbors (and degree d) each earn
+        // CC * c + CD * (d - c); defecting ones earn DC * c + DD * (d - c).
+        const double coop_fitness = payoff_CC * (double)sum_c_coop[id] +
+                                    payoff_CD * (double)(sum_deg_coop[id] - sum_c_coop[id]);
+        const uint64_t defect_c = sum_c_all[id] - sum_c_coop[id];
+        const uint64_t defect_deg = sum_deg_all[id] - sum_deg_coop[id];
+        const double defect_fitness = payoff_DC * (double)defect_c + payoff_DD * (double)(defect_deg - defect_c);
+        const double total_fitness = coop_fitness + defect_fitness;
+
+        // If neighbor fitnesses are non-zero, choose one of them (or the focal organism).
+        if (total_fitness > 0) {
+            const double choice = tally.random.GetDouble(total_fitness + fitness[id]);
+            if (choice < total_fitness) new_coop = choice < coop_fitness;
+        }
+    } else {
+        // Determine the total fitness of neighbors.
+        double total_fitness = 0;
+        for (const uint32_t* n = nbr_begin; n < nbr_end; n++) {
+            total_fitness += fitness[*n];
+        }
+        QM_PERF_COUNT(tally.perf.neighbors_scanned, nbr_end - nbr_begin);
+
+        // If neighbor fitnesses are non-zero, choose one of them.
+        if (total_fitness > 0) {
+            // Include the focal organism in the pool
+            double choice = tally.random.GetDouble(total_fitness + fitness[id]);
+
+            // If we aren't keeping the focal organism, we have to pick
+            if (choice < total_fitness) {
+                const uint32_t* n = nbr_begin;
+                for (; n < nbr_end; n++) {
+                    if (choice < fitness[*n]) {
+                        new_coop = IsCoop(*n);  // Copy strategy of winner!
+                        break;
+                    }
+                    choice -= fitness[*n];
                 }
-                choice -= pop[n].fitness;
+                QM_PERF_COUNT(tally.perf.neighbors_scanned, n - nbr_begin + (n < nbr_end));
             }
         }
     }
 
     // If we haven't changed our strategy, no need to continue.
-    if (org.coop == start_coop) return;
+    if (new_coop == start_coop) return;
+    // Atomic, as other tiles of a parallel epoch may be flipping bits in the same word.
+    __atomic_fetch_xor(&coop_bits[id >> 6], (uint64_t)1 << (id & 63), __ATOMIC_RELAXED);
+    if (new_coop) tally.num_coop++;
+    else tally.num_coop--;
+    tally.epoch_flips++;
+    QM_PERF_COUNT(tally.perf.flips, 1);
+    FlipCounts(id, tally);
+    if (event_driven) FlipActive(id);
 
     // Now that we have updated the organism, calculate its fitness again
     // (even if no change, since neighbors may have changed).
-    CalcFitness(id);
+    CalcFitness(id, tally);
     // Also update neighbors' fitnesses
-    for (size_t n : org.neighbors) {
-        CalcFitness(n);
+    for (const uint32_t* n = nbr_begin; n < nbr_end; n++) {
+        CalcFitness(*n, tally);
+    }
+    QM_PERF_COUNT(tally.perf.neighbors_scanned, nbr_end - nbr_begin);
+}
+
+// Collect the active organisms (BuildCounts must have run).
+void SimplePDWorld::BuildActive() {
+    active_list.clear();
+    active_pos.assign(N, NOT_ACTIVE);
+    for (size_t id = 0; id < N; id++) UpdateActive(id);
+}
+
+// Add id to, or remove it from, the active list to match its neighbor counts.
+void SimplePDWorld::UpdateActive(size_t id) {
+    if (GetNumOtherNeighbors(id) > 0) {
+        if (active_pos[id] != NOT_ACTIVE) return;
+        active_pos[id] = (uint32_t)active_list.size();
+        active_list.push_back((uint32_t)id);
+    } else {
+        const uint32_t pos = active_pos[id];
+        if (pos == NOT_ACTIVE) return;
+        const uint32_t last = active_list.back();
+        active_list[pos] = last;
+        active_pos[last] = pos;
+        active_list.pop_back();
+        active_pos[id] = NOT_ACTIVE;
+    }
+}
+
+// id just changed strategy (and FlipCounts has run): only id and its neighbors can have changed.
+void SimplePDWorld::FlipActive(size_t id) {
+    UpdateActive(id);
+    const uint32_t* nbr_end = neighbor_ids.data() + neighbor_start[id + 1];
+    const uint32_t* nbr_begin = neighbor_ids.data() + neighbor_start[id];
+    for (const uint32_t* n = nbr_begin; n < nbr_end; n++) UpdateActive(*n);
+    QM_PERF_COUNT(perf.neighbors_scanned, nbr_end - nbr_begin);
+}
+
+// One epoch of N Repro calls, doing only the ones that land on an active organism. Each call
+// lands on an active organism with probability p = (active count) / N, so the number of calls
+// before the next one that does is geometric with parameter p; draw it and skip them.
+void SimplePDWorld::EventEpoch() {
+    size_t calls_left = N;
+    while (calls_left && active_list.size()) {
+        const double p = (double)active_list.size() / (double)N;
+        if (p < 1.0) {
+            const double skip = std::floor(std::log(1.0 - random.GetDouble()) / std::log1p(-p));
+            if (skip >= (double)calls_left) return;
+            calls_left -= (size_t)skip;
+        }
+        calls_left--;
+        ReproAt(active_list[random.GetUInt(active_list.size())]);
+    }
+}
+
+// Sort organisms into the tiles of the parallel update (see SetParallel); the serial update is
+// used if the tiles asked for would leave fewer than two per side.
+void SimplePDWorld::BuildTiles() {
+    tiles_per_side = 0;
+    tile_start.clear();
+    tile_orgs.clear();
+    if (parallel_tiles == 0) return;
+    size_t tiles = parallel_tiles;
+    // Tiles must be wider than 4r; the margin covers rounding where positions are binned.
+    while (tiles > 1 && 4.0 * r * (double)tiles > 1.0 - 1e-9) tiles--;
+    tiles &= ~(size_t)1;  // Even, so the checkerboard colors line up across the wrap
+    if (tiles < 2) return;
+    tiles_per_side = tiles;
+
+    auto tile_coord = [tiles](double pos) {
+        size_t c = (size_t)(pos * (double)tiles);
+        return (c < tiles) ? c : tiles - 1;
+    };
+    const size_t num_tiles = tiles * tiles;
+    emp::vector<uint32_t> org_tile(N);
+    tile_start.assign(num_tiles + 1, 0);
+    for (size_t id = 0; id < N; id++) {
+        org_tile[id] = (uint32_t)(tile_coord(pos_y[id]) * tiles + tile_coord(pos_x[id]));
+        tile_start[org_tile[id] + 1]++;
+    }
+    for (size_t k = 0; k < num_tiles; k++) tile_start[k + 1] += tile_start[k];
+    tile_orgs.resize(N);
+    emp::vector<uint32_t> fill_pos(tile_start.begin(), tile_start.end() - 1);
+    for (size_t id = 0; id < N; id++) tile_orgs[fill_pos[org_tile[id]]++] = (uint32_t)id;
+    tile_states.resize(num_tiles);
+}
+
+// One epoch of the parallel update (see SetParallel). Each tile's random stream is derived from
+// one draw of the world's own, so the world's state (and its checkpoints) stays that of the
+// serial update.
+void SimplePDWorld::ParallelEpoch() {
+    const size_t tiles = tiles_per_side;
+    const uint64_t epoch_key = random.Get64();
+    for (size_t k = 0; k < tile_states.size(); k++) {
+        tile_states[k] = TileState();
+        tile_states[k].random.ResetSeed(epoch_key, k);
+    }
+
+    const size_t half = tiles / 2;
+    for (size_t color = 0; color < 4; color++) {
+        const std::function<void(size_t)> run_tile = [this, tiles, half, color](size_t i) {
+            const size_t k = (2 * (i / half) + color / 2) * tiles + 2 * (i % half) + color % 2;
+            TileState& tile = tile_states[k];
+            Tally tally = tile.GetTally();
+            const uint32_t* orgs = tile_orgs.data() + tile_start[k];
+            const uint32_t count = tile_start[k + 1] - tile_start[k];
+            for (uint32_t call = 0; call < count; call++) ReproAt(orgs[tile.random.GetUInt(count)], tally);
+        };
+        pool->Run(half * half, run_tile);
+    }
+
+    for (const TileState& tile : tile_states) {
+        num_coop += tile.num_coop;
+        fitness_sum += tile.fitness_sum;
+        epoch_flips += tile.epoch_flips;
+        perf += tile.perf;
     }
 }
 
 // Count how many cooperators we currently have in the population.
-size_t SimplePDWorld::CountCoop() {
-    size_t count = 0.0;
-    for (Org& org : pop)
-        if (org.coop) count++;
-    return count;
+size_t SimplePDWorld::CountCoop() const {
+    emp_assert(num_coop == RecountCoop(), num_coop);
+    return num_coop;
+}
+
+// Count cooperators from scratch (for checking the running count).
+size_t SimplePDWorld::RecountCoop() const {
+    return pdkernels::Popcount(coop_bits.data(), coop_bits.size());
 }
 
 // Print out a histogram of neighborhood sizes.
 void SimplePDWorld::PrintNeighborInfo(std::ostream& os) {
     size_t total = 0;
     size_t max_size = 0;
-    size_t min_size = pop[0].neighbors.size();
-    for (Org& org : pop) {
-        size_t cur_size = org.neighbors.size();
+    size_t min_size = GetNumNeighbors(0);
+    for (size_t id = 0; id < N; id++) {
+        size_t cur_size = GetNumNeighbors(id);
         total += cur_size;
         if (cur_size > max_size) max_size = cur_size;
         if (cur_size < min_size) min_size = cur_size;
     }
     emp::vector<int> hist(max_size + 1, 0);
-    for (Org& org : pop) {
-        size_t cur_size = org.neighbors.size();
+    for (size_t id = 0; id < N; id++) {
+        size_t cur_size = GetNumNeighbors(id);
         hist[cur_size]++;
     }
     // double avg_size = ((double) total) / (double) N;
@@ -246,4 +902,74 @@ void SimplePDWorld::PrintNeighborInfo(std::ostream& os) {
     os.flush();
 }
 
+static constexpr uint32_t SIMPLEPDWORLD_STATE_MAGIC = 0x33574450;  // "PDW3"
+
+void SimplePDWorld::SaveState(std::ostream& os) const {
+    WriteBinary(os, SIMPLEPDWORLD_STATE_MAGIC);
+    WriteBinary(os, r);
+    WriteBinary(os, u);
+    WriteBinary<uint64_t>(os, N);
+    WriteBinary<uint64_t>(os, E);
+    WriteBinary<uint8_t>(os, use_ave);
+    WriteBinary<uint64_t>(os, epoch);
+    WriteBinary(os, random.GetSeed());
+    WriteBinary(os, random.GetKey());
+    WriteBinary(os, random.GetCounter());
+    WriteBinary<uint64_t>(os, num_coop);
+    WriteBinary(os, fitness_sum);
+    WriteBinary<uint64_t>(os, epoch_flips);
+    WriteBinary<uint64_t>(os, last_epoch_flips);
+    WriteBinary(os, stop);
+    WriteBinary(os, stop_reason);
+    WriteBinary(os, steady.min_fraction);
+    WriteBinary(os, steady.max_fraction);
+    WriteBinary<uint64_t>(os, steady.since);
+    WriteBinary(os, pos_x);
+    WriteBinary(os, pos_y);
+    WriteBinary(os, coop_bits);
+    WriteBinary(os, fitness);
+}
+
+// @return false if the stream does not hold a complete snapshot (the world is then unusable
+// until the next Setup or LoadState).
+bool SimplePDWorld::LoadState(std::istream& is) {
+    uint32_t magic = 0;
+    if (!ReadBinary(is, magic) || magic != SIMPLEPDWORLD_STATE_MAGIC) return false;
+
+    uint64_t N64, E64, epoch64, seed, key, counter, coop64, flips64, last_flips64, steady64;
+    uint8_t ave;
+    if (!ReadBinary(is, r) || !ReadBinary(is, u) || !ReadBinary(is, N64) || !ReadBinary(is, E64) ||
+        !ReadBinary(is, ave) || !ReadBinary(is, epoch64) || !ReadBinary(is, seed) || !ReadBinary(is, key) ||
+        !ReadBinary(is, counter) || !ReadBinary(is, coop64) || !ReadBinary(is, fitness_sum) ||
+        !ReadBinary(is, flips64) || !ReadBinary(is, last_flips64) || !ReadBinary(is, stop) ||
+        !ReadBinary(is, stop_reason) || !ReadBinary(is, steady.min_fraction) ||
+        !ReadBinary(is, steady.max_fraction) || !ReadBinary(is, steady64) || !ReadBinary(is, pos_x) ||
+        !ReadBinary(is, pos_y) || !ReadBinary(is, coop_bits) || !ReadBinary(is, fitness)) {
+        return false;
+    }
+    N = N64;
+    E = E64;
+    use_ave = ave;
+    epoch = epoch64;
+    num_coop = coop64;
+    epoch_flips = flips64;
+    last_epoch_flips = last_flips64;
+    steady.since = steady64;
+    start_time = std::chrono::steady_clock::now();  // The time budget starts over on resume.
+    if (pos_x.size() != N || pos_y.size() != N || fitness.size() != N || coop_bits.size() != (N + 63) / 64) {
+        return false;
+    }
+
+    random.ResetSeed(seed);
+    random.SetState(key, counter);
+
+    r_sqr = r * r;
+    SetupPayoffs();
+    BuildNeighbors();
+    BuildCounts();
+    BuildTiles();
+    if (event_driven) BuildActive();
+    return true;
+}
+
 }
\ No newline at end of file
@@ -0,0 +1,101 @@
+/**
+ *  @note This file is part of Empirical, https://github.com/devosoft/Empirical
+ *  @copyright Copyright (C) Michigan State University, MIT Software license; see doc/LICENSE.md
+ *  @date 2020
+ *
+ *  @file  threadpool.h
+ *  @brief A fixed set of threads that run the tasks of one parallel loop at a time.
+ *  @note Status:
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "base/vector.h"
+
+namespace emp {
+
+/// Threads that wait between loops, so a caller that runs many short parallel loops (such as the
+/// four phases of every SimplePDWorld parallel epoch) does not start threads for each one. The
+/// calling thread takes tasks too, so a pool of one thread starts none and just runs the loop.
+class ThreadPool {
+   private:
+    emp::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable start_cv;  // Signalled when a loop starts, or the pool stops
+    std::condition_variable done_cv;   // Signalled when the last helper leaves a loop
+    const std::function<void(size_t)>* task = nullptr;
+    size_t num_tasks = 0;
+    std::atomic<size_t> next_task{0};
+    size_t generation = 0;  // Loops started so far, so each helper joins each loop once
+    size_t busy = 0;        // Helpers still in the current loop
+    bool stopping = false;
+
+    /// Takes tasks of the current loop until there are none left.
+    void Work() {
+        for (size_t i = next_task++; i < num_tasks; i = next_task++) (*task)(i);
+    }
+
+    void Helper() {
+        size_t seen = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            start_cv.wait(lock, [this, seen]() { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+            lock.unlock();
+            Work();
+            lock.lock();
+            if (--busy == 0) done_cv.notify_one();
+        }
+    }
+
+   public:
+    /// A pool of num_threads threads in all, counting the caller of Run (0 for one per hardware thread).
+    ThreadPool(size_t num_threads = 0) {
+        if (num_threads == 0) num_threads = std::thread::hardware_concurrency();
+        for (size_t i = 1; i < num_threads; i++) threads.emplace_back(&ThreadPool::Helper, this);
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        start_cv.notify_all();
+        for (std::thread& thread : threads) thread.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t GetNumThreads() const { return threads.size() + 1; }
+
+    /// Calls fun(0) through fun(count - 1), spread over the pool in no particular order, and
+    /// returns once every call has. Only one thread may call Run at a time.
+    void Run(size_t count, const std::function<void(size_t)>& fun) {
+        if (threads.empty() || count < 2) {
+            for (size_t i = 0; i < count; i++) fun(i);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            task = &fun;
+            num_tasks = count;
+            next_task = 0;
+            busy = threads.size();
+            generation++;
+        }
+        start_cv.notify_all();
+        Work();
+        std::unique_lock<std::mutex> lock(mutex);
+        done_cv.wait(lock, [this]() { return busy == 0; });
+    }
+};
+
+}  // namespace emp
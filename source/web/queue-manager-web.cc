@@ -2,13 +2,26 @@
 //  Copyright (C) Michigan State University, 2017.
 //  Released under the MIT Software license; see doc/LICENSE
 // PD WORLD EXAMPLE
+//
+// The world itself runs in a Web Worker (queue-manager-worker.cc), so a fast-forwarding run
+// cannot freeze the page: the page sends requests, keeps the latest snapshot the worker answers
+// with, and draws it at the display rate. The page itself only keeps the settings for the next
+// Randomize; only the worker owns a world. Each snapshot of a queued run goes to the queue through
+// the same WorldReporter that a WorldDriver uses, so the page shows the metrics the native
+// driver records.
 
-#include <functional>
 #include <string>
+#include <utility>
+
+#include <emscripten.h>
 
 #include "../configsetup.h"
+#include "../counterrandom.h"
+#include "../pdimage.h"
+#include "../pdsnapshot.h"
 #include "../queue-manager.h"
 #include "../simplepdworld.h"
+#include "../worlddriver.h"
 #include "web/web.h"
 
 namespace UI = emp::web;
@@ -19,35 +32,45 @@ UI::Document doc("emp_base");
 // Config created
 emp::SettingConfig config = emp::setup();
 emp::QueueManager run_list(config);
-emp::SimplePDWorld world;
+emp::WorldReporter<emp::SimplePDWorld> reporter(run_list);  // Registers the metrics before the table is made
+emp::PDParams settings;  // Settings for the next Randomize
+
+worker_handle sim_worker;
+const size_t NO_RUN = (size_t)-1;
+uint64_t cur_token = 0;         // Token of the run the worker is running (see pdsnapshot.h)
+size_t cur_run_id = NO_RUN;     // Queued run the worker is running, if any
+size_t calls_in_flight = 0;     // Requests the worker has not answered yet
+emp::CounterRandom seed_random(1);  // Seeds for Randomize
+
+emp::PDSnapshot shown;              // Latest snapshot of the current run
+emp::PDSnapshot incoming;           // Snapshot being unpacked
+size_t shown_epoch = 0;
+bool shown_dirty = false;           // shown has changed since it was last drawn
+emp::PDImage image((size_t)world_size, (size_t)world_size);  // The canvas contents
 
 int cur_x = -1;
 int cur_y = -1;
 
+// Redraws the organisms that changed since the last frame into the image, and puts the whole
+// image on the canvas in one call.
 void DrawCanvas() {
-    UI::Canvas canvas = doc.Canvas("canvas");
-    canvas.Clear("black");
-
-    const emp::vector<emp::Org>& pop = world.GetPop();
-
-    if (cur_x >= 0) {
-        canvas.Circle(cur_x, cur_y, world_size * world.GetR(), "pink");
-    }
+    if (image.GetNumOrgs() == shown.N) image.Update(shown.coop_bits);
 
-    for (const emp::Org& org : pop) {
-        if (org.coop) {
-            canvas.Circle(org.x * world_size, org.y * world_size, 2, "blue", "#8888FF");
-        } else {
-            canvas.Circle(org.x * world_size, org.y * world_size, 2, "#FF8888", "red");
-        }
-    }
+    EM_ASM({
+        var canvas = document.getElementById(UTF8ToString($0));
+        if (!canvas) return;
+        var pixels = new Uint8ClampedArray(HEAPU8.buffer, $1, $2 * $3 * 4);
+        canvas.getContext('2d').putImageData(new ImageData(pixels, $2, $3), 0, 0);
+    }, "canvas", image.GetPixels(), (int)image.GetWidth(), (int)image.GetHeight());
 
     doc.Text("ud_text").Redraw();
+    shown_dirty = false;
 }
 
 void CanvasClick(int x, int y) {
     cur_x = x;
     cur_y = y;
+    image.SetHighlight(cur_x, cur_y, world_size * shown.r);
     DrawCanvas();
 }
 
@@ -67,82 +90,128 @@ void TogglePlay() {
         but.SetLabel("Fast Forward!");
 }
 
-int anim_step = 1;
+bool fast_forward = false;
+const double frame_seconds = 1.0 / 60.0;  // Worker time per fast-forward request
+
+void OnSnapshot(char* data, int size, void*);
+
+void StartRun(const emp::PDParams& params, uint64_t seed, size_t run_id) {
+    emp::PDStartRequest request;
+    request.token = ++cur_token;
+    request.params = params;
+    request.seed = seed;
+    cur_run_id = run_id;
+    calls_in_flight++;
+    emscripten_call_worker(sim_worker, "pdw_start", (char*)&request, sizeof(request), OnSnapshot, nullptr);
+}
+
+void StepRun(size_t max_epochs, double max_seconds) {
+    emp::PDStepRequest request;
+    request.token = cur_token;
+    request.max_epochs = max_epochs;
+    request.max_seconds = max_seconds;
+    if (cur_run_id != NO_RUN && !run_list.IsEmpty() && run_list.FrontRun().id == cur_run_id) {
+        request.limit = run_list.FrontRun().params->E;  // The queue ends the run there
+    }
+    calls_in_flight++;
+    emscripten_call_worker(sim_worker, "pdw_step", (char*)&request, sizeof(request), OnSnapshot, nullptr);
+}
+
+// Gives the idle worker its next request: the front queued run, if it has not been started,
+// or else more of the current run (one epoch when playing, a frame's worth when fast forwarding).
+void RequestNext() {
+    if (calls_in_flight) return;
+    if (!run_list.IsEmpty() && run_list.FrontRun().id != cur_run_id) {
+        const emp::RunInfo& run = run_list.FrontRun();
+        StartRun(run.GetParams(), run.seed, run.id);
+    } else if (fast_forward) {
+        StepRun((size_t)-1, frame_seconds);
+    } else {
+        StepRun(1, 0.0);
+    }
+}
+
+void OnSnapshot(char* data, int size, void*) {
+    calls_in_flight--;
+    if (!incoming.Read(data, (size_t)size) || incoming.token != cur_token) return;  // Stale
+    if (incoming.HasPositions()) {
+        image.SetPositions(incoming.pos_x, incoming.pos_y);
+        if (cur_x >= 0) image.SetHighlight(cur_x, cur_y, world_size * incoming.r);
+    }
+    std::swap(shown, incoming);
+    shown_epoch = shown.epoch;
+    shown_dirty = true;
+
+    if (cur_run_id != NO_RUN && !run_list.IsEmpty() && run_list.FrontRun().id == cur_run_id) {
+        run_list.SetWorldPerf(shown.perf);
+        reporter.Report(shown);  //calculations for table
+    }
+
+    // Fast forward keeps the worker busy (while it has anything to do); the page draws whichever
+    // snapshot is latest.
+    const bool idle = shown.stop_reason != emp::StopReason::NONE && run_list.IsEmpty();
+    if (fast_forward && !idle && doc.Animate("anim_world").GetActive()) RequestNext();
+}
+
+// Starts a new world with the current settings (not part of the queue).
+void Randomize(uint64_t seed) {
+    StartRun(settings, seed, NO_RUN);
+}
 
 int main() {
-    std::function<std::string()> defect_func = [&]() { return std::to_string(config.GetValue<size_t>("N_value") - (run_list.FrontRun()).num_coop); };
-    run_list.AddDepVariable(defect_func, "Epoch");
-    run_list.AddDepVariable(defect_func, "Num Coop");
-    run_list.AddDepVariable(defect_func, "Num Defect");
+    sim_worker = emscripten_create_worker("queue-manager-worker.js");
+
     doc << "<h2>Spatial Prisoner's Dilema</h2>";
     auto canvas = doc.AddCanvas(world_size, world_size, "canvas");
     // canvas.On("click", CanvasClick);
     auto& anim = doc.AddAnimation("anim_world", []() {
-        // if queue has runs
-        if (!run_list.IsEmpty()) {
-            emp::RunInfo run = run_list.FrontRun();  // Referencing current run
-            if (run.cur_epoch == 0) {                // Are we starting a new run?
-                world.Setup(run.runinfo_config.GetValue<double>("r_value"), run.runinfo_config.GetValue<double>("u_value"), run.runinfo_config.GetValue<size_t>("N_value"), run.runinfo_config.GetValue<size_t>("E_value"));
-
-                DrawCanvas();
-            }
-        }
-        world.Run(anim_step);
-        DrawCanvas();
-        if (!run_list.IsEmpty()) {
-            run_list.SetEpoch(world.GetEpoch());
-            run_list.SetNumCoop(world.CountCoop());
-            run_list.DivTableCalc();  //calculations for table
-        }
+        RequestNext();  // Does nothing while the worker is busy
+        if (shown_dirty) DrawCanvas();
     });
 
     doc << "<br>";
     doc.AddButton([&anim]() {
-        anim_step = 1;
+        fast_forward = false;
         TogglePlay();
     },
                   "Play", "start_but");
-    doc.AddButton([]() { world.Run(1); DrawCanvas(); }, "Step", "step_but");
+    doc.AddButton([]() { if (!calls_in_flight) StepRun(1, 0.0); }, "Step", "step_but");
     doc.AddButton([&anim]() {
-        anim_step = 100;
+        fast_forward = true;
         TogglePlay();
     },
                   "Fast Forward!", "run_but");
-    doc.AddButton([]() { world.Reset(); DrawCanvas(); }, "Randomize", "rand_but");
+    doc.AddButton([]() { Randomize(seed_random.Get64()); }, "Randomize", "rand_but");
     auto ud_text = doc.AddText("ud_text");
-    ud_text << " Epoch = " << UI::Live(world.epoch);
+    ud_text << " Epoch = " << UI::Live(shown_epoch);
 
     doc << "<br>Radius (<i>r</i>) = ";
     doc.AddTextArea([](const std::string& str) {
-           double r = emp::from_string<double>(str);
-           world.SetR(r);
+           settings.r = emp::from_string<double>(str);
        },
                     "r_set")
-        .SetText(emp::to_string(world.GetR()));
+        .SetText(emp::to_string(settings.r));
 
     doc << "<br>cost/benefit ratio (<i>u</i>) = ";
     doc.AddTextArea([](const std::string& str) {
-           double u = emp::from_string<double>(str);
-           world.SetU(u);
+           settings.u = emp::from_string<double>(str);
        },
                     "u_set")
-        .SetText(emp::to_string(world.GetU()));
+        .SetText(emp::to_string(settings.u));
 
     doc << "<br>Population Size (<i>N</i>) = ";
     doc.AddTextArea([](const std::string& str) {
-           size_t N = emp::from_string<size_t>(str);
-           world.SetN(N);
+           settings.N = emp::from_string<size_t>(str);
        },
                     "N_set")
-        .SetText(emp::to_string(world.GetN()));
+        .SetText(emp::to_string(settings.N));
 
     doc << "<br>Num Epochs on Run (<i>E</i>) = ";
     doc.AddTextArea([](const std::string& str) {
-           size_t E = emp::from_string<size_t>(str);
-           world.SetE(E);
+           settings.E = emp::from_string<size_t>(str);
        },
                     "E_set")
-        .SetText(emp::to_string(world.GetE()));
+        .SetText(emp::to_string(settings.E));
 
     doc << "<br>"
         << "NOTE: You must hit 'Randomize' after changing any parameters for them to take effect."
@@ -154,11 +223,24 @@ int main() {
         << "<br>"
         << "How many runs? ";
 
-    size_t num_runs = run_list.DivAddTextArea();
-    world.SetNumRuns(num_runs);
+    const size_t num_runs = run_list.DivAddTextArea();
+
+    doc << "<br>"
+        << "To sweep settings instead, list them here, e.g. <tt>r_value=0.01:0.05:5; u_value=0.1,0.175</tt> "
+        << "(a range as lo:hi:count, or a list of values; add <tt>lhs=K</tt> for K Latin-hypercube samples). "
+        << "Each point gets the number of runs above. ";
+    run_list.DivAddSweepArea();
+
+    doc << "<br>"
+        << "To end runs early, give stop conditions, e.g. <tt>fixation; steady=0.01:500; budget=60</tt> "
+        << "(all organisms share a strategy; the cooperator fraction stays within 0.01 for 500 epochs; 60 seconds). ";
+    run_list.DivAddStopArea();
+
+    doc << "<br>"
+        << "To cancel a queued run, or run it next, give its run number here. ";
+    run_list.DivAddScheduleArea();
 
-    size_t queue_runs = world.GetNumRuns();
-    run_list.DivButton(queue_runs);
+    run_list.DivButton(num_runs);
 
     doc << "<br>";
 
@@ -166,4 +248,5 @@ int main() {
     run_list.DivAddTable(1, 8, "result_tab");
 
     DrawCanvas();
+    Randomize(0);
 }
\ No newline at end of file
@@ -0,0 +1,60 @@
+//  This file is part of Project Name
+//  Copyright (C) Michigan State University, 2020.
+//  Released under the MIT Software license; see doc/LICENSE
+//
+//  Web Worker that runs the SimplePDWorld for the web page (see ../pdsnapshot.h); built with
+//  BUILD_AS_WORKER, so it has no page of its own and only answers calls.
+
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#include <emscripten.h>
+
+#include "../pdsnapshot.h"
+#include "../simplepdworld.h"
+
+static_assert(std::is_trivially_copyable<emp::PDStartRequest>::value, "requests are posted as raw bytes");
+static_assert(std::is_trivially_copyable<emp::PDStepRequest>::value, "requests are posted as raw bytes");
+
+emp::SimplePDWorld world;
+uint64_t token = 0;
+emp::PDSnapshot snapshot;
+std::string reply;
+
+void Respond(bool with_positions) {
+    snapshot.token = token;
+    snapshot.Capture(world, with_positions);
+    snapshot.Write(reply);
+    emscripten_worker_respond(&reply[0], (int)reply.size());
+}
+
+extern "C" {
+
+EMSCRIPTEN_KEEPALIVE void pdw_start(char* data, int size) {
+    emp::PDStartRequest request;
+    if (size != sizeof(request)) return;
+    std::memcpy(&request, data, sizeof(request));
+    token = request.token;
+    world.Setup(request.params, request.seed);
+    Respond(true);
+}
+
+EMSCRIPTEN_KEEPALIVE void pdw_step(char* data, int size) {
+    emp::PDStepRequest request;
+    if (size != sizeof(request)) return;
+    std::memcpy(&request, data, sizeof(request));
+    if (request.token == token) {
+        // One epoch at a time, so a time slice ends within an epoch of its deadline.
+        const auto start = std::chrono::steady_clock::now();
+        for (uint64_t step = 0; step < request.max_epochs; step++) {
+            if (world.IsStopped() || world.GetEpoch() >= request.limit) break;
+            if (step && std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() >= request.max_seconds) break;
+            world.Run(1);
+        }
+    }
+    Respond(false);
+}
+
+}
@@ -0,0 +1,200 @@
+/**
+ *  @note This file is part of Empirical, https://github.com/devosoft/Empirical
+ *  @copyright Copyright (C) Michigan State University, MIT Software license; see doc/LICENSE.md
+ *  @date 2020
+ *
+ *  @file  worlddriver.h
+ *  @brief Works through a QueueManager's runs with any kind of world.
+ *  @note Status:
+ */
+
+/// A world type WORLD_T can be driven by a WorldDriver if it has
+///
+///     void Setup(const params_t& params, uint64_t seed);  // Start a run from scratch
+///     void Run(size_t steps);                             // Run up to steps more epochs
+///     size_t GetEpoch() const;
+///     StopReason GetStopReason() const;                   // StopReason::NONE while it goes on
+///
+/// and WorldParams<WORLD_T> and WorldMetrics<WORLD_T> specializations. WorldParams names the
+/// world's own parameter record (params_t), builds it for a queued run and gives its epoch count;
+/// a run is done once it reaches that count or stops. WorldMetrics lists the metrics shown in the
+/// results table as a tuple of (name, getter) pairs, where a getter may return any arithmetic
+/// type. It also gives the value that the cross-replicate summaries sample.
+///
+/// A driver either works through the front run of the queue (Step), or runs whichever runs its
+/// owner takes off the queue (Start, RunTo; see BatchRunner). Progress of the front run goes to
+/// the queue through a WorldReporter, which registers each metric with the queue when it is
+/// constructed (fixing the metric's slot). Publishing the metrics is unrolled at compile time
+/// over the tuple into direct slot writes, with no name lookups and no std::function calls.
+///
+/// A reporter reads the world only through WorldMetrics, GetEpoch and GetStopReason, so it can
+/// also report a stand-in for a world that runs elsewhere: the web page reports the PDSnapshot
+/// its Web Worker sends back (see pdsnapshot.h), since the world itself lives in the worker.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <tuple>
+#include <utility>
+
+#include "queue-manager.h"
+#include "simplepdworld.h"
+
+namespace emp {
+
+/// A named metric of a world; get is called with a const world.
+template <typename GETTER_T>
+struct WorldMetric {
+    const char* name;
+    GETTER_T get;
+};
+
+template <typename GETTER_T>
+constexpr WorldMetric<GETTER_T> MakeMetric(const char* name, GETTER_T get) {
+    return {name, get};
+}
+
+/// Specialize for each world type (see the notes at the top of this file).
+template <typename WORLD_T>
+struct WorldParams;
+
+/// Specialize for each world type (see the notes at the top of this file).
+template <typename WORLD_T>
+struct WorldMetrics;
+
+template <>
+struct WorldParams<SimplePDWorld> {
+    using params_t = PDParams;
+    static PDParams FromRun(const RunInfo& run) { return run.GetParams(); }
+    static size_t GetEpochs(const PDParams& params) { return params.E; }
+};
+
+template <>
+struct WorldMetrics<SimplePDWorld> {
+    static auto List() {
+        return std::make_tuple(
+            MakeMetric("Num Coop", [](const auto& world) { return world.CountCoop(); }),
+            MakeMetric("Num Defect", [](const auto& world) { return world.GetN() - world.CountCoop(); }));
+    }
+
+    /// Cooperator fraction (of a SimplePDWorld, or a PDSnapshot of one)
+    template <typename VIEW_T>
+    static double SampleValue(const VIEW_T& world) {
+        return world.GetN() ? (double)world.CountCoop() / (double)world.GetN() : 0.0;
+    }
+};
+
+/// Reports the progress of the queue's front run, as seen in a WORLD_T (or a stand-in for one;
+/// see the notes at the top of this file).
+template <typename WORLD_T>
+class WorldReporter {
+   private:
+    using metrics_t = decltype(WorldMetrics<WORLD_T>::List());
+    static constexpr size_t NUM_METRICS = std::tuple_size<metrics_t>::value;
+
+    QueueManager& queue;
+    metrics_t metrics;
+    std::array<size_t, NUM_METRICS> slots{};  // Queue metric slot of each metric (if registered)
+
+    template <size_t... I>
+    void RegisterMetrics(std::index_sequence<I...>) {
+        ((slots[I] = queue.AddMetric(std::get<I>(metrics).name)), ...);
+    }
+
+    template <typename VIEW_T, size_t... I>
+    void PublishMetrics(const VIEW_T& world, std::index_sequence<I...>) {
+        (queue.SetMetric(slots[I], (double)std::get<I>(metrics).get(world)), ...);
+    }
+
+   public:
+    /// With show_metrics set, registers the world's metrics with _queue for its results table (so
+    /// construct the reporter before DivAddTable).
+    WorldReporter(QueueManager& _queue, bool show_metrics = true) : queue(_queue), metrics(WorldMetrics<WORLD_T>::List()) {
+        if (show_metrics) RegisterMetrics(std::make_index_sequence<NUM_METRICS>());
+    }
+
+    size_t GetSlot(size_t metric) const { return slots[metric]; }
+
+    /// Reports world as the front run's progress to the queue, which ends the run once it is done.
+    template <typename VIEW_T>
+    void Report(const VIEW_T& world) {
+        queue.SetEpoch(world.GetEpoch());
+        queue.SetStopReason(world.GetStopReason());
+        queue.SetSampleValue(WorldMetrics<WORLD_T>::SampleValue(world));
+        PublishMetrics(world, std::make_index_sequence<NUM_METRICS>());
+        queue.DivTableCalc();
+    }
+};
+
+template <typename WORLD_T>
+class WorldDriver {
+   public:
+    using params_t = typename WorldParams<WORLD_T>::params_t;
+
+   private:
+    static constexpr size_t NO_RUN = (size_t)-1;
+
+    QueueManager& queue;
+    WORLD_T world;
+    WorldReporter<WORLD_T> reporter;
+    size_t run_id = NO_RUN;                   // Queued run the world holds, if any
+    params_t params;                          // Parameters of that run
+    size_t epochs = 0;                        // Its epoch count
+
+   public:
+    /// With show_metrics set, registers the world's metrics with _queue for its results table (so
+    /// construct the driver before DivAddTable); a driver that only runs taken runs needs none.
+    WorldDriver(QueueManager& _queue, bool show_metrics = true) : queue(_queue), reporter(_queue, show_metrics) { }
+
+    WORLD_T& GetWorld() { return world; }
+    const WORLD_T& GetWorld() const { return world; }
+    size_t GetSlot(size_t metric) const { return reporter.GetSlot(metric); }
+    const params_t& GetParams() const { return params; }
+    size_t GetEpochs() const { return epochs; }
+
+    /// Sets the world up for run, from scratch.
+    void Start(const RunInfo& run) {
+        SetRun(run);
+        world.Setup(params, run.seed);
+    }
+
+    /// Makes run the world's run without setting the world up (e.g. just after loading the run's
+    /// checkpoint into GetWorld()).
+    void SetRun(const RunInfo& run) {
+        run_id = run.id;
+        params = WorldParams<WORLD_T>::FromRun(run);
+        epochs = WorldParams<WORLD_T>::GetEpochs(params);
+    }
+
+    bool IsDone() const { return world.GetEpoch() >= epochs || world.GetStopReason() != StopReason::NONE; }
+
+    /// Runs the world up to epoch (or its epoch count, if that comes first) unless it stops sooner.
+    void RunTo(size_t epoch) {
+        epoch = std::min(epoch, epochs);
+        if (world.GetEpoch() < epoch) world.Run(epoch - world.GetEpoch());
+    }
+
+    /// The value the cross-replicate summaries sample, now.
+    double GetSampleValue() const { return WorldMetrics<WORLD_T>::SampleValue(world); }
+
+    /// Runs up to steps epochs of the front queued run (setting it up first if it is new) and
+    /// reports its progress to the queue, which ends the run once it is done.
+    /// @return false if the queue is empty
+    bool Step(size_t steps) {
+        if (queue.IsEmpty()) return false;
+        const RunInfo& run = queue.FrontRun();
+        if (run.id != run_id) Start(run);
+        RunTo(world.GetEpoch() + std::min(steps, epochs));
+        reporter.Report(world);
+        return true;
+    }
+
+    /// Works through the whole queue, steps epochs at a time.
+    void RunAll(size_t steps = 100) {
+        while (Step(steps)) { ; }
+    }
+};
+
+}  // namespace emp
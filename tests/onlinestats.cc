@@ -0,0 +1,55 @@
+#define CATCH_CONFIG_MAIN
+
+#include "Catch/single_include/catch2/catch.hpp"
+
+#include <sstream>
+
+#include "onlinestats.h"
+
+TEST_CASE("Online mean and variance match a two-pass computation", "[onlinestats]")
+{
+    const emp::vector<double> values = {0.5, 0.25, 0.75, 0.1, 0.9, 0.45, 0.55, 0.3};
+    emp::OnlineStats stats;
+    for (double value : values) stats.Add(value);
+
+    double mean = 0.0;
+    for (double value : values) mean += value;
+    mean /= values.size();
+    double variance = 0.0;
+    for (double value : values) variance += (value - mean) * (value - mean);
+    variance /= (values.size() - 1);
+
+    REQUIRE(stats.count == values.size());
+    REQUIRE(stats.mean == Approx(mean));
+    REQUIRE(stats.GetVariance() == Approx(variance));
+    REQUIRE(stats.min == 0.1);
+    REQUIRE(stats.max == 0.9);
+}
+
+TEST_CASE("Merged summaries equal the summary of the combined stream", "[onlinestats]")
+{
+    emp::SampleSummary all, first, second;
+    for (size_t i = 0; i < 1000; i++) {
+        const double value = (double)((i * 7919) % 1000) / 1000.0;
+        all.Add(value);
+        (i % 3 ? first : second).Add(value);
+    }
+    first.Merge(second);
+
+    REQUIRE(first.stats.count == all.stats.count);
+    REQUIRE(first.stats.mean == Approx(all.stats.mean));
+    REQUIRE(first.stats.GetVariance() == Approx(all.stats.GetVariance()));
+    REQUIRE(first.stats.min == all.stats.min);
+    REQUIRE(first.stats.max == all.stats.max);
+    for (double q : {0.1, 0.5, 0.9}) {
+        REQUIRE(first.Quantile(q) == all.Quantile(q));
+        REQUIRE(all.Quantile(q) == Approx(q).margin(1.0 / 32));  // Within one bin of the true quantile
+    }
+
+    std::stringstream ss;
+    all.SaveState(ss);
+    emp::SampleSummary loaded;
+    REQUIRE(loaded.LoadState(ss));
+    REQUIRE(loaded.stats.mean == all.stats.mean);
+    REQUIRE(loaded.Quantile(0.5) == all.Quantile(0.5));
+}
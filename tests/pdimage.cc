@@ -0,0 +1,66 @@
+#define CATCH_CONFIG_MAIN
+
+#include "Catch/single_include/catch2/catch.hpp"
+
+#include "pdimage.h"
+#include "simplepdworld.h"
+
+emp::vector<float> Positions(const emp::SimplePDWorld& world, bool y) {
+    emp::vector<float> pos(world.GetN());
+    for (size_t id = 0; id < world.GetN(); id++) pos[id] = (float)(y ? world.GetY(id) : world.GetX(id));
+    return pos;
+}
+
+TEST_CASE("Drawing only changed organisms gives the same image as drawing all", "[pdimage]")
+{
+    emp::SimplePDWorld world(0.05, 0.175, 3000, 50, false, 5);
+    const auto pos_x = Positions(world, false);
+    const auto pos_y = Positions(world, true);
+
+    emp::PDImage image(150, 120);  // Not square, and crowded enough that discs overlap
+    image.SetPositions(pos_x, pos_y);
+    REQUIRE( image.Update(world.coop_bits) == world.GetN() );
+    REQUIRE( image.Update(world.coop_bits) == 0 );
+
+    for (size_t step = 0; step < 5; step++) {
+        emp::vector<bool> before(world.GetN());
+        for (size_t id = 0; id < world.GetN(); id++) before[id] = world.IsCoop(id);
+        world.Run(2);
+        size_t changed = 0;
+        for (size_t id = 0; id < world.GetN(); id++) changed += before[id] != world.IsCoop(id);
+        REQUIRE( image.Update(world.coop_bits) == changed );
+
+        emp::PDImage fresh(150, 120);
+        fresh.SetPositions(pos_x, pos_y);
+        fresh.Update(world.coop_bits);
+        for (size_t y = 0; y < image.GetHeight(); y++) {
+            for (size_t x = 0; x < image.GetWidth(); x++) REQUIRE( image.GetPixel(x, y) == fresh.GetPixel(x, y) );
+        }
+    }
+
+    // A highlight only shows where no organism is.
+    image.SetHighlight(75, 60, 30);
+    REQUIRE( image.Update(world.coop_bits) == world.GetN() );
+    size_t highlighted = 0;
+    for (size_t y = 0; y < image.GetHeight(); y++) {
+        for (size_t x = 0; x < image.GetWidth(); x++) highlighted += image.GetPixel(x, y) == emp::PDImage::HIGHLIGHT;
+    }
+    REQUIRE( highlighted > 0 );
+    REQUIRE( image.GetPixel(0, 0) != emp::PDImage::HIGHLIGHT );
+}
+
+TEST_CASE("Organisms are drawn as filled, outlined discs", "[pdimage]")
+{
+    emp::PDImage image(20, 10);
+    image.SetPositions({0.25f, 0.75f}, {0.5f, 0.5f});  // Centers (5, 5) and (15, 5)
+    image.Update({1});                                  // Organism 0 cooperates
+    REQUIRE( image.GetPixel(4, 4) == emp::PDImage::COOP_FILL );
+    REQUIRE( image.GetPixel(4, 6) == emp::PDImage::COOP_LINE );
+    REQUIRE( image.GetPixel(14, 4) == emp::PDImage::DEFECT_FILL );
+    REQUIRE( image.GetPixel(16, 4) == emp::PDImage::DEFECT_LINE );
+    REQUIRE( image.GetPixel(10, 5) == emp::PDImage::BACKGROUND );
+
+    REQUIRE( image.Update({2}) == 2 );
+    REQUIRE( image.GetPixel(4, 4) == emp::PDImage::DEFECT_FILL );
+    REQUIRE( image.GetPixel(14, 4) == emp::PDImage::COOP_FILL );
+}
@@ -0,0 +1,83 @@
+#define CATCH_CONFIG_MAIN
+
+#include "Catch/single_include/catch2/catch.hpp"
+
+#include "pdkernels.h"
+#include "simplepdworld.h"
+
+using emp::pdkernels::KernelLevel;
+
+// Runs fun once at every kernel level this CPU supports, then restores the best level.
+template <typename FUN_T>
+void ForEachLevel(FUN_T&& fun) {
+    const KernelLevel best = emp::pdkernels::DetectKernelLevel();
+    for (int level = 0; level <= (int)best; level++) {
+        emp::pdkernels::SetKernelLevel((KernelLevel)level);
+        REQUIRE( emp::pdkernels::GetKernelLevel() == (KernelLevel)level );
+        fun();
+    }
+    emp::pdkernels::SetKernelLevel(best);
+}
+
+TEST_CASE("Popcount matches the scalar count at every level", "[pdkernels]")
+{
+    emp::CounterRandom random(11);
+    for (size_t num_words : {0, 1, 3, 4, 5, 17, 100}) {
+        emp::vector<uint64_t> words(num_words);
+        for (uint64_t& word : words) word = random.Get64() & random.Get64();
+        const size_t expected = emp::pdkernels::PopcountScalar(words.data(), num_words);
+        ForEachLevel([&]() { REQUIRE( emp::pdkernels::Popcount(words.data(), num_words) == expected ); });
+    }
+}
+
+TEST_CASE("Neighbor counts and fitness match the scalar path exactly", "[pdkernels]")
+{
+    for (double r : {0.02, 0.1, 0.3}) {
+        for (bool use_ave : {false, true}) {
+            emp::SimplePDWorld world(r, 0.175, 1003, 10, use_ave, 6);  // N not a multiple of 4 or 64
+            const size_t N = world.GetN();
+            const emp::pdkernels::Payoffs pay = {world.payoff_CC, world.payoff_CD, world.payoff_DC, world.payoff_DD};
+
+            emp::vector<uint32_t> expected_counts(N);
+            emp::pdkernels::CountCoopNeighborsScalar(world.neighbor_start.data(), world.neighbor_ids.data(),
+                                                     world.coop_bits.data(), expected_counts.data(), N);
+            emp::vector<double> expected_fitness(N);
+            emp::pdkernels::ComputeFitnessScalar(expected_counts.data(), world.neighbor_start.data(),
+                                                 world.coop_bits.data(), pay, use_ave, expected_fitness.data(), 0, N);
+
+            // The scalar kernel is CalcFitness itself, in bulk.
+            for (size_t id = 0; id < N; id++) {
+                world.CalcFitness(id);
+                REQUIRE( world.GetFitness(id) == expected_fitness[id] );
+            }
+
+            ForEachLevel([&]() {
+                emp::vector<uint32_t> counts(N);
+                emp::pdkernels::CountCoopNeighbors(world.neighbor_start.data(), world.neighbor_ids.data(),
+                                                   world.coop_bits.data(), counts.data(), N);
+                REQUIRE( counts == expected_counts );
+
+                emp::vector<double> fitness(N);
+                emp::pdkernels::ComputeFitness(counts.data(), world.neighbor_start.data(), world.coop_bits.data(), pay,
+                                               use_ave, fitness.data(), N);
+                REQUIRE( fitness == expected_fitness );  // Bit-identical, not approximately equal
+            });
+        }
+    }
+}
+
+TEST_CASE("Each kernel reports the version it runs", "[pdkernels]")
+{
+    const KernelLevel best = emp::pdkernels::DetectKernelLevel();
+    emp::pdkernels::SetKernelLevel(KernelLevel::SCALAR);
+    REQUIRE( emp::pdkernels::DescribeKernels() == "popcount=scalar neighbors=scalar fitness=scalar" );
+    if (best >= KernelLevel::SSE42) {
+        emp::pdkernels::SetKernelLevel(KernelLevel::SSE42);
+        REQUIRE( emp::pdkernels::DescribeKernels() == "popcount=sse4.2 neighbors=scalar fitness=sse4.2" );
+    }
+    if (best >= KernelLevel::AVX2) {
+        emp::pdkernels::SetKernelLevel(KernelLevel::AVX2);
+        REQUIRE( emp::pdkernels::DescribeKernels() == "popcount=avx2 neighbors=avx2 fitness=avx2" );
+    }
+    emp::pdkernels::SetKernelLevel(best);
+}
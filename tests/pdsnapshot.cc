@@ -0,0 +1,46 @@
+#define CATCH_CONFIG_MAIN
+
+#include "Catch/single_include/catch2/catch.hpp"
+
+#include <string>
+
+#include "pdsnapshot.h"
+#include "simplepdworld.h"
+
+TEST_CASE("Snapshots carry a world's state through one buffer", "[pdsnapshot]")
+{
+    emp::PDParams params;
+    params.r = 0.05;
+    params.N = 700;  // Not a multiple of 64
+    params.stop.fixation = true;
+    emp::SimplePDWorld world;
+    world.Setup(params, 3);
+    world.Run(7);
+
+    for (bool with_positions : {true, false}) {
+        emp::PDSnapshot snapshot;
+        snapshot.token = 12;
+        snapshot.Capture(world, with_positions);
+        std::string buffer;
+        snapshot.Write(buffer);
+
+        emp::PDSnapshot copy;
+        REQUIRE( copy.Read(buffer.data(), buffer.size()) );
+        REQUIRE( copy.token == 12 );
+        REQUIRE( copy.epoch == world.GetEpoch() );
+        REQUIRE( copy.num_coop == world.CountCoop() );
+        REQUIRE( copy.N == params.N );
+        REQUIRE( copy.r == params.r );
+        REQUIRE( copy.stop_reason == world.GetStopReason() );
+        REQUIRE( copy.HasPositions() == with_positions );
+        for (size_t id = 0; id < params.N; id++) {
+            REQUIRE( copy.IsCoop(id) == world.IsCoop(id) );
+            if (with_positions) REQUIRE( copy.pos_x[id] == (float)world.GetX(id) );
+            if (with_positions) REQUIRE( copy.pos_y[id] == (float)world.GetY(id) );
+        }
+
+        // A cut-off or foreign buffer is refused.
+        REQUIRE( !copy.Read(buffer.data(), buffer.size() - 1) );
+        REQUIRE( !copy.Read("PDW2", 4) );
+    }
+}
@@ -0,0 +1,71 @@
+#define CATCH_CONFIG_MAIN
+#define QM_PERF 1
+
+#include <sstream>
+
+#include "Catch/single_include/catch2/catch.hpp"
+
+#include "configsetup.h"
+#include "perfcounters.h"
+#include "queue-manager.h"
+#include "simplepdworld.h"
+
+TEST_CASE("World counters add up", "[perfcounters]")
+{
+    emp::SimplePDWorld world(0.05, 0.175, 500, 50, false, 3);
+    const emp::WorldPerf& setup = world.GetPerf();
+    REQUIRE( setup.repro_calls == 0 );
+    REQUIRE( setup.setup_ns > 0 );
+
+    size_t flips = 0;
+    for (size_t e = 0; e < 50; e++) {
+        world.Run(1);
+        flips += world.GetEpochFlips();
+    }
+    const emp::WorldPerf perf = world.TakePerf();
+    REQUIRE( perf.repro_calls == 500 * 50 );
+    REQUIRE( perf.epochs == 50 );
+    REQUIRE( perf.flips == flips );
+    REQUIRE( perf.flips > 0 );
+    // Each flip recomputes the flipped organism and its neighbors, and reads its neighbor list
+    // at least twice.
+    REQUIRE( perf.calc_fitness_calls > perf.flips );
+    REQUIRE( perf.neighbors_scanned >= 2 * (perf.calc_fitness_calls - perf.flips) );
+    REQUIRE( perf.run_ns > 0 );
+    REQUIRE( world.GetPerf().repro_calls == 0 );
+
+    // Average payoffs also walk the neighbors on every Repro call.
+    world.Setup(0.05, 0.175, 500, 10, true);
+    world.Run(10);
+    REQUIRE( world.GetPerf().repro_calls == 500 * 10 );
+    REQUIRE( world.GetPerf().neighbors_scanned >= world.GetPerf().repro_calls );
+
+    // An event-driven epoch skips the calls that could not change anything.
+    emp::SimplePDWorld event_world(0.05, 0.175, 500, 2000, false, 3);
+    event_world.SetEventDriven();
+    event_world.Run();
+    REQUIRE( event_world.GetPerf().epochs == 2000 );
+    REQUIRE( event_world.GetPerf().repro_calls < 500 * 2000 );
+}
+
+TEST_CASE("Queue timers count taken and finished runs", "[perfcounters]")
+{
+    emp::QueueManager queue(emp::setup());
+    queue.AddRuns(emp::setup(), 3);
+    emp::RunInfo run;
+    for (size_t i = 0; i < 3; i++) REQUIRE( queue.PopRun(run) );
+    REQUIRE( !queue.PopRun(run) );
+    queue.AddRunTime(0.5);
+    queue.AddRunTime(1.5);
+
+    const emp::QueuePerf perf = queue.GetPerf();
+    REQUIRE( perf.runs_taken == 3 );
+    REQUIRE( perf.max_wait_ns <= perf.wait_ns );
+    REQUIRE( perf.runs_timed == 2 );
+    REQUIRE( perf.run_ns == 2000000000 );
+    REQUIRE( perf.max_run_ns == 1500000000 );
+
+    std::ostringstream json;
+    perf.WriteJSON(json);
+    REQUIRE( json.str().find("\"runs_taken\":3,") == 0 );
+}
@@ -0,0 +1,81 @@
+#define CATCH_CONFIG_MAIN
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include "Catch/single_include/catch2/catch.hpp"
+
+#include "recorder.h"
+
+// A fresh, empty directory for series files.
+std::string MakeDir(const std::string& name) {
+    const std::string dir = "recorder-" + name + "-" + std::to_string(getpid());
+    std::system(("rm -rf " + dir).c_str());
+    mkdir(dir.c_str(), 0755);
+    return dir;
+}
+
+size_t CountLines(const std::string& filename) {
+    std::ifstream is(filename);
+    std::string line;
+    size_t count = 0;
+    while (std::getline(is, line)) count++;
+    return count;
+}
+
+TEST_CASE("Recorders keep every interval-th epoch", "[recorder]")
+{
+    const std::string dir = MakeDir("interval");
+    {
+        emp::SeriesWriter writer(dir);
+        emp::SeriesRecorder recorder(writer, 10, 4);
+        recorder.Start(3);
+        for (size_t epoch = 0; epoch <= 95; epoch++) recorder.Record(epoch, epoch, 100 - epoch, 0.5, 1);
+        recorder.Finish();
+    }
+    REQUIRE( CountLines(dir + "/series-3.csv") == 1 + 10 );  // Header, then epochs 0 to 90
+    std::system(("rm -rf " + dir).c_str());
+}
+
+TEST_CASE("Writers make producers wait once max_jobs buffers are queued", "[recorder]")
+{
+    const std::string dir = MakeDir("backpressure");
+    const size_t threads = 4, buffers = 50, rows = 500;
+    size_t waits = 0, peak = 0;
+    {
+        emp::SeriesWriter writer(dir, emp::SeriesWriter::Format::CSV, 2);
+        REQUIRE( writer.GetMaxJobs() == 2 );
+        // Producers that do nothing but hand over full buffers outrun the CSV formatting.
+        emp::vector<std::thread> producers;
+        for (size_t t = 0; t < threads; t++) {
+            producers.emplace_back([&writer, t]() {
+                for (size_t b = 0; b < buffers; b++) {
+                    std::unique_ptr<emp::SeriesBuffer> buffer = writer.TakeBuffer(rows);
+                    for (size_t i = 0; i < rows; i++) {
+                        buffer->epoch.push_back(b * rows + i);
+                        buffer->num_coop.push_back(i);
+                        buffer->num_defect.push_back(rows - i);
+                        buffer->mean_fitness.push_back(0.25);
+                        buffer->flips.push_back(0);
+                    }
+                    writer.Submit(t, std::move(buffer), b > 0, b + 1 == buffers);
+                }
+            });
+        }
+        for (std::thread& producer : producers) producer.join();
+        waits = writer.GetNumWaits();
+        peak = writer.GetPeakJobs();
+    }
+    REQUIRE( peak <= 2 );
+    REQUIRE( waits > 0 );
+    // Waiting loses nothing: every run's file has every row.
+    for (size_t t = 0; t < threads; t++) {
+        REQUIRE( CountLines(dir + "/series-" + std::to_string(t) + ".csv") == 1 + buffers * rows );
+    }
+    std::system(("rm -rf " + dir).c_str());
+}
@@ -0,0 +1,357 @@
+#define CATCH_CONFIG_MAIN
+
+#include <algorithm>
+#include <set>
+#include <sstream>
+
+#include "Catch/single_include/catch2/catch.hpp"
+
+#include "configsetup.h"
+#include "paramsweep.h"
+#include "queue-manager.h"
+
+// Takes every run off the queue, in order.
+emp::vector<emp::RunInfo> Drain(emp::QueueManager& queue) {
+    emp::vector<emp::RunInfo> runs;
+    emp::RunInfo run;
+    while (queue.PopRun(run)) runs.push_back(run);
+    return runs;
+}
+
+emp::vector<size_t> Ids(const emp::vector<emp::RunInfo>& runs) {
+    emp::vector<size_t> ids;
+    for (const emp::RunInfo& run : runs) ids.push_back(run.id);
+    return ids;
+}
+
+// Every run must carry the parameters of its point, the replicate count and its own seed.
+void RequireConsistent(const emp::vector<emp::RunInfo>& runs, const emp::ParamSweep& sweep, size_t first_id,
+                       uint64_t base_seed) {
+    for (const emp::RunInfo& run : runs) {
+        const size_t point = (run.id - first_id) / sweep.GetReplicates();
+        REQUIRE( run.point_id == point );
+        REQUIRE( run.replicates == sweep.GetReplicates() );
+        REQUIRE( run.seed == emp::CounterRandom::DeriveSeed(base_seed, run.id) );
+        double value = 0.0;
+        REQUIRE( run.GetParams().GetValue("N_value", value) );
+        REQUIRE( value == sweep.GetValue(point, 0) );
+    }
+}
+
+// Finish time of each run when workers take runs in the given order and each run takes its
+// estimated cost.
+emp::vector<double> ListSchedule(const emp::vector<emp::RunInfo>& runs, size_t workers) {
+    emp::vector<double> free_at(workers, 0.0), finish;
+    for (const emp::RunInfo& run : runs) {
+        auto worker = std::min_element(free_at.begin(), free_at.end());
+        *worker += run.GetParams().EstimateCost();
+        finish.push_back(*worker);
+    }
+    return finish;
+}
+
+TEST_CASE("The estimated cost grows with N, r and E", "[runschedule]")
+{
+    emp::PDParams params;
+    params.r = 0.05;
+    params.N = 1000;
+    params.E = 100;
+    const double cost = params.EstimateCost();
+    REQUIRE( cost == Approx(100.0 * 1000.0 * (1.0 + M_PI * 0.05 * 0.05 * 999.0)) );
+    params.E = 200;
+    REQUIRE( params.EstimateCost() == Approx(2.0 * cost) );
+    params.r = 0.1;
+    REQUIRE( params.EstimateCost() > 2.0 * cost );
+    params.r = 2.0;  // The neighborhood cannot hold more than the whole world.
+    REQUIRE( params.EstimateCost() == Approx(200.0 * 1000.0 * 1000.0) );
+}
+
+TEST_CASE("Policies and priorities order the queue", "[runschedule]")
+{
+    emp::QueueManager queue(emp::setup());
+    queue.AddRuns(emp::setup(0.02, 0.175, 5000, 100), 2);  // ids 0, 1
+    queue.AddRuns(emp::setup(0.02, 0.175, 100, 100), 2);   // ids 2, 3
+    queue.AddRuns(emp::setup(0.02, 0.175, 1000, 100), 1);  // id 4
+
+    std::stringstream saved;
+    queue.SaveQueue(saved);
+    REQUIRE( Ids(Drain(queue)) == emp::vector<size_t>({0, 1, 2, 3, 4}) );
+
+    REQUIRE( queue.LoadQueue(saved) );
+    queue.SetSchedule(emp::SchedulePolicy::SJF);
+    REQUIRE( Ids(Drain(queue)) == emp::vector<size_t>({2, 3, 4, 0, 1}) );
+
+    saved.clear();
+    saved.seekg(0);
+    REQUIRE( queue.LoadQueue(saved) );
+    queue.SetSchedule(emp::SchedulePolicy::LJF);
+    REQUIRE( queue.Reprioritize(3, 1) );
+    REQUIRE( queue.GetTopPriority() == 1 );
+    REQUIRE( Ids(Drain(queue)) == emp::vector<size_t>({3, 0, 1, 4, 2}) );
+
+    // New runs take the priority set when they are added.
+    queue.SetSchedule(emp::SchedulePolicy::FIFO);
+    queue.AddRuns(emp::setup(), 2);  // ids 5, 6
+    queue.SetPriority(-1);
+    queue.AddRuns(emp::setup(), 1);  // id 7
+    queue.SetPriority(0);
+    queue.AddRuns(emp::setup(), 1);  // id 8
+    REQUIRE( Ids(Drain(queue)) == emp::vector<size_t>({5, 6, 8, 7}) );
+}
+
+TEST_CASE("A run scheduled at the front keeps its place", "[runschedule]")
+{
+    emp::QueueManager queue(emp::setup());
+    queue.SetSchedule(emp::SchedulePolicy::SJF);
+    queue.AddRuns(emp::setup(0.02, 0.175, 5000, 100), 1);  // id 0
+    REQUIRE( queue.FrontRun().id == 0 );
+    queue.AddRuns(emp::setup(0.02, 0.175, 100, 100), 1);   // id 1
+    REQUIRE( queue.FrontRun().id == 0 );
+    REQUIRE( !queue.Reprioritize(0, 5) );
+    REQUIRE( Ids(Drain(queue)) == emp::vector<size_t>({0, 1}) );
+}
+
+TEST_CASE("Cancelling and reprioritizing split sweeps correctly", "[runschedule]")
+{
+    emp::ParamSweep sweep;
+    REQUIRE( sweep.Parse("N_value=800,100,400") );
+    sweep.SetReplicates(3);
+    emp::QueueManager queue(emp::setup(0.02, 0.175, 100, 20));
+    queue.SetBaseSeed(9);
+    REQUIRE( queue.AddSweep(emp::setup(0.02, 0.175, 100, 20), sweep) == 0 );  // ids 0 to 8
+
+    emp::RunInfo run;
+    REQUIRE( queue.PopRun(run) );  // id 0; the batch is now part way through point 0
+    emp::RunInfo cancelled;
+    REQUIRE( queue.CancelRun(4, cancelled) );  // Middle replicate of point 1
+    REQUIRE( cancelled.id == 4 );
+    REQUIRE( cancelled.point_id == 1 );
+    REQUIRE( !queue.CancelRun(4, cancelled) );
+    REQUIRE( !queue.CancelRun(0, cancelled) );  // Already taken
+    REQUIRE( queue.Reprioritize(7, 2) );
+    REQUIRE( queue.Reprioritize(2, 1) );
+    REQUIRE( queue.RunsRemaining() == 7 );
+
+    std::stringstream saved;
+    queue.SaveQueue(saved);
+    emp::vector<emp::RunInfo> runs = Drain(queue);
+    REQUIRE( Ids(runs) == emp::vector<size_t>({7, 2, 1, 3, 5, 6, 8}) );
+    RequireConsistent(runs, sweep, 0, 9);
+
+    // The same split queue under SJF: points 1 (N=100), 2 (N=400), then 0 (N=800).
+    REQUIRE( queue.LoadQueue(saved) );
+    queue.SetSchedule(emp::SchedulePolicy::SJF);
+    runs = Drain(queue);
+    REQUIRE( Ids(runs) == emp::vector<size_t>({7, 2, 3, 5, 6, 8, 1}) );
+    RequireConsistent(runs, sweep, 0, 9);
+
+    // A whole sweep is ranked point by point.
+    queue.SetSchedule(emp::SchedulePolicy::LJF);
+    REQUIRE( queue.AddSweep(emp::setup(0.02, 0.175, 100, 20), sweep) == 9 );  // ids 9 to 17 (points 3 to 5)
+    std::stringstream sweep_saved;
+    queue.SaveQueue(sweep_saved);
+    emp::vector<emp::RunInfo> sweep_runs = Drain(queue);
+    REQUIRE( Ids(sweep_runs) == emp::vector<size_t>({9, 10, 11, 15, 16, 17, 12, 13, 14}) );
+    REQUIRE( sweep_runs[0].point_id == 3 );
+    REQUIRE( sweep_runs[3].GetParams().N == 400 );
+    REQUIRE( sweep_runs[6].GetParams().N == 100 );
+    REQUIRE( queue.LoadQueue(sweep_saved) );
+    REQUIRE( Ids(Drain(queue)) == Ids(sweep_runs) );
+    queue.SetSchedule(emp::SchedulePolicy::FIFO);
+
+    // Point 1 now completes with two replicates.
+    emp::PointSummary summary;
+    REQUIRE( queue.GetSummary(1, summary) );
+    REQUIRE( summary.runs_expected == 2 );
+    for (size_t id : {3, 5}) {
+        emp::RunInfo done;
+        done.id = id;
+        done.point_id = 1;
+        done.replicates = 3;
+        done.params = runs[0].params;
+        REQUIRE( queue.AddRunSamples(done, {0.5}) == (id == 5) );
+    }
+
+    // Cancelling every replicate of a point leaves no summary.
+    queue.AddRuns(emp::setup(), 2);  // ids 18, 19 (point 6)
+    REQUIRE( queue.CancelRun(19, cancelled) );
+    REQUIRE( queue.GetSummary(6, summary) );
+    REQUIRE( queue.CancelRun(18, cancelled) );
+    REQUIRE( !queue.GetSummary(6, summary) );
+    REQUIRE( queue.IsEmpty() );
+}
+
+TEST_CASE("SJF brings the first results sooner and LJF packs workers tighter", "[runschedule]")
+{
+    const size_t workers = 4;
+    emp::QueueManager queue(emp::setup());
+    emp::vector<size_t> sizes = {3000, 1500, 3000, 1500, 200, 200, 200, 200, 200, 200, 6000};  // The largest last
+    for (size_t N : sizes) queue.AddRuns(emp::setup(0.05, 0.175, N, 100), 1);
+    std::stringstream saved;
+    queue.SaveQueue(saved);
+
+    auto finish_times = [&](emp::SchedulePolicy policy) {
+        saved.clear();
+        saved.seekg(0);
+        REQUIRE( queue.LoadQueue(saved) );
+        queue.SetSchedule(policy);
+        return ListSchedule(Drain(queue), workers);
+    };
+    const emp::vector<double> fifo = finish_times(emp::SchedulePolicy::FIFO);
+    const emp::vector<double> sjf = finish_times(emp::SchedulePolicy::SJF);
+    const emp::vector<double> ljf = finish_times(emp::SchedulePolicy::LJF);
+
+    REQUIRE( *std::min_element(sjf.begin(), sjf.end()) < *std::min_element(fifo.begin(), fifo.end()) );
+    double fifo_total = 0.0, sjf_total = 0.0;
+    for (double t : fifo) fifo_total += t;
+    for (double t : sjf) sjf_total += t;
+    REQUIRE( sjf_total < fifo_total );
+    REQUIRE( *std::max_element(ljf.begin(), ljf.end()) < *std::max_element(fifo.begin(), fifo.end()) );
+}
+
+TEST_CASE("SJF and LJF walk a sweep's points without a batch per point", "[runschedule]")
+{
+    // 400 points whose cost rises and falls, so neither id order nor its reverse is right.
+    emp::ParamSweep sweep;
+    REQUIRE( sweep.Parse("E_value=30,10,20,40; N_value=100:1090:100") );
+    sweep.SetReplicates(2);
+    REQUIRE( sweep.GetNumPoints() == 400 );
+    emp::QueueManager queue(emp::setup());
+    queue.SetBaseSeed(4);
+    queue.SetSchedule(emp::SchedulePolicy::SJF);
+    REQUIRE( queue.AddSweep(emp::setup(), sweep) == 0 );
+    REQUIRE( queue.GetNumBatches() == 1 );
+
+    emp::RunInfo run, cancelled;
+    REQUIRE( queue.PopRun(run) );
+    REQUIRE( queue.CancelRun(run.id + 1, cancelled) );  // The rest of the first point
+    REQUIRE( queue.CancelRun(500, cancelled) );
+    REQUIRE( queue.Reprioritize(301, 1) );
+    REQUIRE( queue.GetNumBatches() <= 4 );
+    std::stringstream saved;
+    queue.SaveQueue(saved);
+
+    auto check = [&](const emp::vector<emp::RunInfo>& runs, bool cheapest_first) {
+        REQUIRE( runs.size() == 797 );
+        REQUIRE( runs[0].id == 301 );
+        std::set<size_t> ids;
+        for (size_t i = 0; i < runs.size(); i++) {
+            const emp::RunInfo& taken = runs[i];
+            ids.insert(taken.id);
+            REQUIRE( taken.point_id == taken.id / 2 );
+            REQUIRE( taken.seed == emp::CounterRandom::DeriveSeed(4, taken.id) );
+            REQUIRE( taken.GetParams().E == sweep.GetValue(taken.point_id, 0) );
+            REQUIRE( taken.GetParams().N == sweep.GetValue(taken.point_id, 1) );
+            if (i > 1) {
+                const double before = runs[i - 1].GetParams().EstimateCost(), cost = taken.GetParams().EstimateCost();
+                REQUIRE( (cheapest_first ? before <= cost : before >= cost) );
+            }
+        }
+        REQUIRE( ids.size() == runs.size() );
+        REQUIRE( !ids.count(500) );
+        REQUIRE( !ids.count(run.id) );
+    };
+    const emp::vector<emp::RunInfo> sjf = Drain(queue);
+    check(sjf, true);
+
+    // The saved walk comes back in the same order; switching policy re-sorts it.
+    REQUIRE( queue.LoadQueue(saved) );
+    REQUIRE( Ids(Drain(queue)) == Ids(sjf) );
+    saved.clear();
+    saved.seekg(0);
+    REQUIRE( queue.LoadQueue(saved) );
+    queue.SetSchedule(emp::SchedulePolicy::LJF);
+    REQUIRE( queue.GetNumBatches() <= 8 );  // Points cut part way keep batches of their own
+    check(Drain(queue), false);
+
+    // Back in queue order, each piece of the walk becomes a batch per stretch of consecutive ids.
+    saved.clear();
+    saved.seekg(0);
+    REQUIRE( queue.LoadQueue(saved) );
+    queue.SetSchedule(emp::SchedulePolicy::FIFO);
+    REQUIRE( queue.GetNumBatches() < 20 );
+    const emp::vector<size_t> fifo = Ids(Drain(queue));
+    REQUIRE( fifo[0] == 301 );
+    REQUIRE( std::is_sorted(fifo.begin() + 1, fifo.end()) );
+}
+
+TEST_CASE("Sweeps of unknown settings are turned away", "[runschedule]")
+{
+    emp::ParamSweep sweep;
+    REQUIRE( !sweep.Parse("u_value=0.1,0.2; r=0.01:0.05:3", emp::PDParams::SettingNames()) );
+    REQUIRE( sweep.GetParseError() == "unknown setting \"r\"" );
+
+    // Without a list of names the spec reads, but the queue will not take it.
+    emp::ParamSweep unchecked;
+    REQUIRE( unchecked.Parse("r=0.01:0.05:3") );
+    REQUIRE( unchecked.GetParseError().empty() );
+    emp::QueueManager queue(emp::setup());
+    REQUIRE( queue.AddSweep(emp::setup(), unchecked) == 0 );
+    REQUIRE( queue.IsEmpty() );
+
+    emp::ParamSweep good;
+    REQUIRE( good.Parse("r_value=0.01:0.05:3", emp::PDParams::SettingNames()) );
+    REQUIRE( queue.AddSweep(emp::setup(), good) == 0 );
+    REQUIRE( queue.RunsRemaining() == 3 );
+}
+
+TEST_CASE("The results table makes the text of a row only when it is shown", "[runschedule]")
+{
+    // A million runs cost one block of rows, not a million rows of text.
+    emp::ParamSweep sweep;
+    REQUIRE( sweep.Parse("r_value=0.01:0.05:5; N_value=100:1000:200000", emp::PDParams::SettingNames()) );
+    sweep.SetReplicates(1);
+    emp::QueueManager queue(emp::setup());
+    queue.DivAddTable(1, 8, "table");
+    const size_t first_id = queue.AddSweep(emp::setup(), sweep);
+    queue.DivButtonTable(first_id, sweep.GetNumRuns(), std::make_shared<emp::ParamSweep>(sweep));
+    queue.DivRedrawTable();
+    REQUIRE( queue.GetNumTableRows() == 1000000 );
+
+    emp::vector<std::string> cells;
+    queue.MakeTableRow(999999, cells);
+    REQUIRE( cells[0] == "999999" );
+    REQUIRE( cells.back() == "Waiting..." );
+    REQUIRE( std::count(cells.begin(), cells.end(), emp::to_string(sweep.GetValue(999999, 0))) >= 1 );
+
+    size_t row = 0;
+    queue.DivInfoTable(5, 42, emp::StopReason::FIXATION);
+    REQUIRE( queue.FindRunRow(5, row) );
+    REQUIRE( row == 5 );
+    queue.MakeTableRow(row, cells);
+    REQUIRE( std::count(cells.begin(), cells.end(), "42 (fixation)") == 1 );
+    REQUIRE( !queue.FindRunRow(1000000, row) );
+}
+
+TEST_CASE("Sweeps that repeat a setting or have too many points are turned away", "[runschedule]")
+{
+    emp::ParamSweep twice;
+    REQUIRE( !twice.Parse("r_value=0.01:0.05:3; r_value=0.1", emp::PDParams::SettingNames()) );
+    REQUIRE( twice.GetParseError() == "\"r_value\" is swept more than once" );
+    emp::ParamSweep built;
+    built.AddValues("r_value", {0.01}).AddValues("r_value", {0.02});
+    REQUIRE( built.HasRepeatedAxis() );
+    emp::QueueManager queue(emp::setup());
+    REQUIRE( queue.AddSweep(emp::setup(), built) == 0 );
+    REQUIRE( queue.IsEmpty() );
+
+    // 2^20 * 2^20 points fit a size_t but not the queue's 32-bit point numbers.
+    emp::ParamSweep large;
+    REQUIRE( !large.Parse("r_value=0:1:1048576; u_value=0:1:1048576", emp::PDParams::SettingNames()) );
+    REQUIRE( large.GetParseError() == "the sweep has more than 4294967295 points" );
+    REQUIRE( large.GetNumAxes() == 1 );
+
+    // A range is turned away before its values are made.
+    emp::ParamSweep range;
+    REQUIRE( !range.Parse("r_value=0:1:1e12", emp::PDParams::SettingNames()) );
+    REQUIRE( range.GetNumAxes() == 0 );
+
+    // A sweep that fits can still have more runs than a size_t counts.
+    emp::ParamSweep many;
+    REQUIRE( many.Parse("r_value=0:1:65536", emp::PDParams::SettingNames()) );
+    REQUIRE( !many.IsTooLarge() );
+    many.SetReplicates(SIZE_MAX / 2);
+    REQUIRE( many.IsTooLarge() );
+    REQUIRE( queue.AddSweep(emp::setup(), many) == 0 );
+    REQUIRE( queue.IsEmpty() );
+}
@@ -0,0 +1,261 @@
+#define CATCH_CONFIG_MAIN
+
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include "Catch/single_include/catch2/catch.hpp"
+
+#include "configsetup.h"
+#include "queue-manager.h"
+#include "sharedqueue.h"
+
+// A fresh, empty directory for a shared queue.
+std::string MakeDir(const std::string& name) {
+    const std::string dir = "sharedqueue-" + name + "-" + std::to_string(getpid());
+    std::system(("rm -rf " + dir).c_str());
+    mkdir(dir.c_str(), 0755);
+    return dir;
+}
+
+emp::vector<std::string> ReadLines(const std::string& filename) {
+    emp::vector<std::string> lines;
+    std::ifstream is(filename);
+    std::string line;
+    while (std::getline(is, line)) lines.push_back(line);
+    return lines;
+}
+
+// Joins the queue in dir (starting it with runs replicates if it is new) and finishes every run
+// it can take, writing each run's id as its result line. Runs in a child process, so it exits
+// instead of returning.
+void WorkerProcess(const std::string& dir, size_t runs) {
+    emp::QueueManager queue(emp::setup(0.02, 0.175, 100, 10));
+    queue.SetSummaryInterval(10);
+    queue.AddRuns(emp::setup(0.02, 0.175, 100, 10), runs);
+    emp::SharedQueue shared(queue, dir);
+    shared.SetPollSeconds(0.01);
+    bool created = false;
+    if (!shared.Join("id\n", created)) _exit(1);
+    emp::RunInfo run;
+    while (shared.TakeRun(run)) {
+        if (!shared.Finish(run, {0.5}, std::to_string(run.id) + "\n")) _exit(2);
+    }
+    _exit(0);
+}
+
+TEST_CASE("Several processes share one queue", "[sharedqueue]")
+{
+    const std::string dir = MakeDir("share");
+    emp::vector<pid_t> children;
+    for (size_t i = 0; i < 4; i++) {
+        const pid_t pid = fork();
+        if (pid == 0) WorkerProcess(dir, 50);
+        children.push_back(pid);
+    }
+    for (pid_t pid : children) {
+        int status = 0;
+        REQUIRE( waitpid(pid, &status, 0) == pid );
+        REQUIRE( WIFEXITED(status) );
+        REQUIRE( WEXITSTATUS(status) == 0 );
+    }
+
+    // Every run exactly once, and one summary for the point.
+    emp::vector<std::string> lines = ReadLines(dir + "/results.csv");
+    REQUIRE( lines.size() == 51 );
+    REQUIRE( lines[0] == "id" );
+    emp::vector<size_t> count(50, 0);
+    for (size_t i = 1; i < lines.size(); i++) count[std::stoul(lines[i])]++;
+    for (size_t c : count) REQUIRE( c == 1 );
+    lines = ReadLines(dir + "/summary.csv");
+    REQUIRE( lines.size() == 2 );
+    REQUIRE( lines[1].substr(0, 2) == "0," );
+
+    emp::QueueManager queue;
+    emp::SharedQueue shared(queue, dir);
+    bool created = true;
+    REQUIRE( shared.Join("id\n", created) );
+    REQUIRE( !created );
+    size_t queued = 1, leased = 1;
+    REQUIRE( shared.GetCounts(queued, leased) );
+    REQUIRE( queued == 0 );
+    REQUIRE( leased == 0 );
+    std::system(("rm -rf " + dir).c_str());
+}
+
+TEST_CASE("Runs of a process that died are taken over", "[sharedqueue]")
+{
+    const std::string dir = MakeDir("reclaim");
+    int ready[2], done[2];
+    REQUIRE( pipe(ready) == 0 );
+    REQUIRE( pipe(done) == 0 );
+
+    // The child takes two runs and dies without finishing them.
+    const pid_t pid = fork();
+    if (pid == 0) {
+        emp::QueueManager queue(emp::setup(0.02, 0.175, 100, 10));
+        queue.AddRuns(emp::setup(0.02, 0.175, 100, 10), 5);
+        emp::SharedQueue shared(queue, dir);
+        bool created = false;
+        emp::RunInfo run;
+        if (!shared.Join("id\n", created) || !shared.TakeRun(run) || !shared.TakeRun(run)) _exit(1);
+        char byte = 1;
+        if (write(ready[1], &byte, 1) != 1) _exit(1);
+        if (read(done[0], &byte, 1) != 1) _exit(1);  // Waits for the parent's check
+        _exit(0);
+    }
+
+    char byte = 0;
+    REQUIRE( read(ready[0], &byte, 1) == 1 );
+    emp::QueueManager queue;
+    emp::SharedQueue shared(queue, dir);
+    shared.SetPollSeconds(0.01);
+    bool created = true;
+    REQUIRE( shared.Join("id\n", created) );
+    REQUIRE( !created );
+
+    // While the child lives, its runs stay leased.
+    size_t queued = 0, leased = 0;
+    REQUIRE( shared.GetCounts(queued, leased) );
+    REQUIRE( queued == 3 );
+    REQUIRE( leased == 2 );
+    emp::RunInfo run;
+    REQUIRE( shared.TakeRun(run) );
+    REQUIRE( run.id == 2 );
+    REQUIRE( shared.Finish(run, {0.5}, "2\n") );
+
+    REQUIRE( write(done[1], &byte, 1) == 1 );
+    int status = 0;
+    REQUIRE( waitpid(pid, &status, 0) == pid );
+
+    // Now they come back first, in id order.
+    emp::vector<size_t> ids;
+    while (shared.TakeRun(run)) {
+        ids.push_back(run.id);
+        REQUIRE( shared.Finish(run, {0.5}, std::to_string(run.id) + "\n") );
+    }
+    REQUIRE( ids == emp::vector<size_t>({0, 1, 3, 4}) );
+    REQUIRE( ReadLines(dir + "/results.csv").size() == 6 );
+    REQUIRE( ReadLines(dir + "/summary.csv").size() == 2 );
+    std::system(("rm -rf " + dir).c_str());
+}
+
+TEST_CASE("A process waits for runs that others still hold", "[sharedqueue]")
+{
+    const std::string dir = MakeDir("wait");
+    int ready[2];
+    REQUIRE( pipe(ready) == 0 );
+
+    const pid_t pid = fork();
+    if (pid == 0) {
+        emp::QueueManager queue(emp::setup(0.02, 0.175, 100, 10));
+        queue.AddRuns(emp::setup(0.02, 0.175, 100, 10), 1);
+        emp::SharedQueue shared(queue, dir);
+        bool created = false;
+        emp::RunInfo run;
+        if (!shared.Join("id\n", created) || !shared.TakeRun(run)) _exit(1);
+        char byte = 1;
+        if (write(ready[1], &byte, 1) != 1) _exit(1);
+        usleep(200000);
+        _exit(shared.Finish(run, {0.5}, "0\n") ? 0 : 1);
+    }
+
+    char byte = 0;
+    REQUIRE( read(ready[0], &byte, 1) == 1 );
+    emp::QueueManager queue;
+    emp::SharedQueue shared(queue, dir);
+    shared.SetPollSeconds(0.01);
+    bool created = true;
+    REQUIRE( shared.Join("id\n", created) );
+    emp::RunInfo run;
+    REQUIRE( !shared.TakeRun(run) );  // Only returns once the child has finished its run
+    REQUIRE( ReadLines(dir + "/results.csv").size() == 2 );
+    int status = 0;
+    REQUIRE( waitpid(pid, &status, 0) == pid );
+    REQUIRE( WEXITSTATUS(status) == 0 );
+    std::system(("rm -rf " + dir).c_str());
+}
+
+TEST_CASE("A queue state that cannot be read is an error, not a drained queue", "[sharedqueue]")
+{
+    const std::string dir = MakeDir("broken");
+    emp::QueueManager queue(emp::setup(0.02, 0.175, 100, 10));
+    queue.AddRuns(emp::setup(0.02, 0.175, 100, 10), 3);
+    emp::SharedQueue shared(queue, dir);
+    bool created = false;
+    REQUIRE( shared.Join("id\n", created) );
+    REQUIRE( created );
+    REQUIRE( shared.GetError().empty() );
+    struct stat info;
+    REQUIRE( stat((dir + "/queue.state.tmp").c_str(), &info) != 0 );  // Renamed into place
+
+    // Cut the state short, as a torn write would.
+    std::ifstream is(dir + "/queue.state", std::ios::binary);
+    const std::string state((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+    std::ofstream(dir + "/queue.state", std::ios::binary | std::ios::trunc) << state.substr(0, state.size() / 2);
+
+    emp::RunInfo run;
+    REQUIRE( !shared.TakeRun(run) );
+    REQUIRE( shared.GetError() == dir + "/queue.state is cut short" );
+    REQUIRE( !shared.TakeRun(run) );  // Stays stopped
+
+    emp::QueueManager other_queue;
+    emp::SharedQueue other(other_queue, dir);
+    REQUIRE( !other.Join("id\n", created) );
+    REQUIRE( other.GetError().size() );
+    std::system(("rm -rf " + dir).c_str());
+}
+
+TEST_CASE("Finishing a run this process does not hold is an error", "[sharedqueue]")
+{
+    const std::string dir = MakeDir("unleased");
+    emp::QueueManager queue(emp::setup(0.02, 0.175, 100, 10));
+    queue.AddRuns(emp::setup(0.02, 0.175, 100, 10), 2);
+    emp::SharedQueue shared(queue, dir);
+    bool created = false;
+    REQUIRE( shared.Join("id\n", created) );
+    emp::RunInfo run;
+    REQUIRE( shared.TakeRun(run) );
+    emp::RunInfo other = run;
+    other.id = 1;  // Still queued, not leased
+    REQUIRE( !shared.Finish(other, {0.5}, "1\n") );
+    REQUIRE( shared.GetError() == "run 1 is no longer leased to " + shared.GetOwner() );
+    REQUIRE( ReadLines(dir + "/results.csv").size() == 1 );
+    REQUIRE( !shared.TakeRun(run) );
+    std::system(("rm -rf " + dir).c_str());
+}
+
+TEST_CASE("Joining processes take on the queue's schedule, interval and queue times", "[sharedqueue]")
+{
+    const std::string dir = MakeDir("settings");
+    emp::QueueManager first(emp::setup(0.02, 0.175, 100, 10));
+    first.SetSchedule(emp::SchedulePolicy::SJF);
+    first.SetSummaryInterval(5);
+    first.AddRuns(emp::setup(0.02, 0.175, 100, 10), 3);
+    emp::SharedQueue started(first, dir);
+    bool created = false;
+    REQUIRE( started.Join("id\n", created) );
+    REQUIRE( created );
+    usleep(50000);
+
+    emp::QueueManager second;
+    REQUIRE( second.GetSchedule() == emp::SchedulePolicy::FIFO );
+    emp::SharedQueue joined(second, dir);
+    REQUIRE( joined.Join("id\n", created) );
+    REQUIRE( !created );
+    REQUIRE( second.GetSchedule() == emp::SchedulePolicy::SJF );
+    REQUIRE( second.GetSummaryInterval() == 5 );
+
+    // A run waits from when it was first queued, not from when this process loaded it.
+    emp::RunInfo run;
+    REQUIRE( joined.TakeRun(run) );
+    REQUIRE( std::chrono::steady_clock::now() - run.queued_at >= std::chrono::milliseconds(50) );
+    REQUIRE( second.GetSchedule() == emp::SchedulePolicy::SJF );
+    REQUIRE( joined.Finish(run, {0.5, 0.5}, "0\n") );
+    std::system(("rm -rf " + dir).c_str());
+}
@@ -0,0 +1,362 @@
+#define CATCH_CONFIG_MAIN
+
+#include "Catch/single_include/catch2/catch.hpp"
+
+#include <sstream>
+
+#include "simplepdworld.h"
+
+// Reference all-pairs neighbor scan, with toroidal wraparound on both axes.
+emp::vector<emp::vector<size_t>> BruteForceNeighbors(const emp::SimplePDWorld& world) {
+    const size_t N = world.GetN();
+    const double r_sqr = world.GetR() * world.GetR();
+    emp::vector<emp::vector<size_t>> neighbors(N);
+    for (size_t i = 0; i < N; i++) {
+        for (size_t j = 0; j < N; j++) {
+            if (i == j) continue;
+            double x_dist = emp::Abs(world.GetX(i) - world.GetX(j));
+            if (x_dist > (1.0 - x_dist)) x_dist = 1.0 - x_dist;
+            double y_dist = emp::Abs(world.GetY(i) - world.GetY(j));
+            if (y_dist > (1.0 - y_dist)) y_dist = 1.0 - y_dist;
+            if (x_dist * x_dist + y_dist * y_dist < r_sqr) neighbors[i].push_back(j);
+        }
+    }
+    return neighbors;
+}
+
+TEST_CASE("Grid neighbor build matches all-pairs scan", "[simplepdworld]")
+{
+    const double radii[] = {0.02, 0.05, 0.13, 0.3, 0.6};
+    for (int seed = 1; seed <= 5; seed++) {
+        for (double r : radii) {
+            emp::SimplePDWorld world(r, 0.175, 800, 10, false, seed);
+            const auto expected = BruteForceNeighbors(world);
+            REQUIRE( world.neighbor_start.size() == world.GetN() + 1 );
+            for (size_t i = 0; i < world.GetN(); i++) {
+                emp::vector<size_t> found(world.neighbor_ids.begin() + world.neighbor_start[i],
+                                          world.neighbor_ids.begin() + world.neighbor_start[i + 1]);
+                REQUIRE( found == expected[i] );
+            }
+        }
+    }
+}
+
+TEST_CASE("Running aggregates match a full population pass", "[simplepdworld]")
+{
+    for (bool use_ave : {false, true}) {
+        emp::SimplePDWorld world(0.05, 0.175, 1000, 40, use_ave, 7);
+        for (size_t step = 0; step < 4; step++) {
+            world.Run(10);
+
+            size_t coop = 0;
+            double fitness = 0.0;
+            for (size_t id = 0; id < world.GetN(); id++) {
+                if (world.IsCoop(id)) coop++;
+                fitness += world.GetFitness(id);
+            }
+            REQUIRE( world.CountCoop() == coop );
+            REQUIRE( world.GetMeanFitness() == Approx(fitness / (double)world.GetN()) );
+        }
+    }
+}
+
+TEST_CASE("A run depends only on its parameters and seed", "[simplepdworld]")
+{
+    emp::PDParams params;
+    params.r = 0.05;
+    params.N = 1000;
+    params.E = 30;
+
+    // A fresh world...
+    emp::SimplePDWorld fresh;
+    fresh.Setup(params, 42);
+    fresh.Run(params.E);
+
+    // ...and a world that has already done other runs must end up in the same state.
+    emp::SimplePDWorld reused;
+    emp::PDParams other = params;
+    other.N = 700;
+    reused.Setup(other, 7);
+    reused.Run(12);
+    reused.Setup(params, 42);
+    reused.Run(params.E);
+
+    REQUIRE( fresh.CountCoop() == reused.CountCoop() );
+    REQUIRE( fresh.coop_bits == reused.coop_bits );
+    REQUIRE( fresh.fitness == reused.fitness );
+
+    // Different run ids get different seeds from the same base seed.
+    REQUIRE( emp::CounterRandom::DeriveSeed(1, 0) != emp::CounterRandom::DeriveSeed(1, 1) );
+    REQUIRE( emp::CounterRandom::DeriveSeed(1, 0) != emp::CounterRandom::DeriveSeed(2, 0) );
+}
+
+TEST_CASE("A restored checkpoint continues bit-identically", "[simplepdworld]")
+{
+    emp::PDParams params;
+    params.r = 0.05;
+    params.N = 1000;
+    params.E = 40;
+
+    emp::SimplePDWorld straight;
+    straight.Setup(params, 3);
+    straight.Run(params.E);
+
+    emp::SimplePDWorld first_half;
+    first_half.Setup(params, 3);
+    first_half.Run(15);
+    std::stringstream snapshot;
+    first_half.SaveState(snapshot);
+
+    emp::SimplePDWorld restored;
+    REQUIRE( restored.LoadState(snapshot) );
+    REQUIRE( restored.GetEpoch() == 15 );
+    REQUIRE( restored.neighbor_ids == first_half.neighbor_ids );
+    restored.Run(params.E - 15);
+
+    REQUIRE( restored.GetEpoch() == straight.GetEpoch() );
+    REQUIRE( restored.coop_bits == straight.coop_bits );
+    REQUIRE( restored.fitness == straight.fitness );
+    REQUIRE( restored.GetMeanFitness() == straight.GetMeanFitness() );
+
+    // A truncated snapshot is rejected.
+    std::stringstream truncated(snapshot.str().substr(0, 100));
+    REQUIRE( !restored.LoadState(truncated) );
+}
+
+TEST_CASE("Runs stop early at fixation and steady states", "[simplepdworld]")
+{
+    emp::StopConditions stop;
+    REQUIRE( stop.Parse("fixation; steady=0.01:50") );
+    REQUIRE( stop.fixation );
+    REQUIRE( stop.steady_epsilon == 0.01 );
+    REQUIRE( stop.steady_window == 50 );
+    REQUIRE( !stop.Parse("steady=0.01") );
+    REQUIRE( !stop.Parse("sometimes") );
+
+    emp::PDParams params;
+    params.r = 0.05;
+    params.u = 0.05;
+    params.N = 1000;
+    params.E = 2000;
+    params.stop.fixation = true;
+
+    emp::SimplePDWorld world;
+    world.Setup(params, 4);
+    world.Run(params.E);
+    REQUIRE( world.GetStopReason() == emp::StopReason::FIXATION );
+    REQUIRE( world.GetEpoch() < params.E );
+    REQUIRE( (world.CountCoop() == 0 || world.CountCoop() == params.N) );
+
+    // Stopping does not change the trajectory up to the stop.
+    const size_t stop_epoch = world.GetEpoch();
+    emp::PDParams no_stop = params;
+    no_stop.stop = emp::StopConditions();
+    emp::SimplePDWorld straight;
+    straight.Setup(no_stop, 4);
+    straight.Run(stop_epoch);
+    REQUIRE( !straight.IsStopped() );
+    REQUIRE( straight.coop_bits == world.coop_bits );
+
+    // A stopped world stays stopped, including through a checkpoint.
+    world.Run(10);
+    REQUIRE( world.GetEpoch() == stop_epoch );
+    std::stringstream snapshot;
+    world.SaveState(snapshot);
+    emp::SimplePDWorld restored;
+    REQUIRE( restored.LoadState(snapshot) );
+    REQUIRE( restored.GetStopReason() == emp::StopReason::FIXATION );
+
+    // Once fixed, the fraction cannot move, so the steady test fires a window after fixation.
+    params.stop.fixation = false;
+    params.stop.steady_window = 20;
+    world.Setup(params, 4);
+    world.Run(params.E);
+    REQUIRE( world.GetStopReason() == emp::StopReason::STEADY );
+    REQUIRE( world.GetEpoch() <= stop_epoch + 20 );
+}
+
+TEST_CASE("The steady test needs the whole window within epsilon", "[simplepdworld]")
+{
+    emp::StopConditions stop;
+    stop.steady_epsilon = 0.01;
+    stop.steady_window = 50;
+
+    // A slow drift moves less than epsilon in any few epochs but more than it over the window.
+    emp::SteadyWindow drift;
+    drift.Start(0.5, 0);
+    for (size_t epoch = 1; epoch <= 1000; epoch++) REQUIRE( !drift.Add(0.5 + 0.0003 * (double)epoch, epoch, stop) );
+
+    // Sliding down to epsilon below the first fraction, then up to epsilon above it, stays within
+    // epsilon of the first fraction but spans twice epsilon.
+    emp::SteadyWindow swing;
+    swing.Start(0.5, 0);
+    for (size_t epoch = 1; epoch <= 50; epoch++) {
+        const double fraction = epoch <= 25 ? 0.5 - 0.0004 * (double)epoch : 0.49 + 0.0008 * (double)(epoch - 25);
+        REQUIRE( !swing.Add(fraction, epoch, stop) );
+    }
+
+    // Wandering within a range of epsilon stops once the window has passed.
+    emp::SteadyWindow wander;
+    wander.Start(0.5, 0);
+    size_t stopped = 0;
+    for (size_t epoch = 1; epoch <= 100 && !stopped; epoch++) {
+        if (wander.Add(0.5 + (epoch % 3 ? 0.004 : -0.005), epoch, stop)) stopped = epoch;
+    }
+    REQUIRE( stopped == 50 );
+
+    // An empty population has no fraction to test.
+    emp::PDParams params;
+    params.N = 0;
+    params.E = 10;
+    params.stop = stop;
+    emp::SimplePDWorld world;
+    world.Setup(params, 1);
+    world.Run(params.E);
+    REQUIRE( world.GetStopReason() != emp::StopReason::STEADY );
+}
+
+TEST_CASE("Event-driven updating keeps its active set and matches the default process", "[simplepdworld]")
+{
+    emp::PDParams params;
+    params.r = 0.1;
+    params.u = 0.1;
+    params.N = 400;
+    params.E = 30;
+
+    // The maintained neighbor counts and active list match a fresh count.
+    emp::SimplePDWorld world;
+    world.SetEventDriven(true);
+    world.Setup(params, 5);
+    for (size_t step = 0; step < 10; step++) {
+        world.Run(3);
+        for (size_t id = 0; id < params.N; id++) {
+            size_t diff = 0;
+            for (uint64_t i = world.neighbor_start[id]; i < world.neighbor_start[id + 1]; i++) {
+                if (world.IsCoop(world.neighbor_ids[i]) != world.IsCoop(id)) diff++;
+            }
+            REQUIRE( world.GetNumOtherNeighbors(id) == diff );
+            REQUIRE( (world.active_pos[id] != emp::SimplePDWorld::NOT_ACTIVE) == (diff > 0) );
+            if (diff) REQUIRE( world.active_list[world.active_pos[id]] == id );
+        }
+        REQUIRE( world.GetNumActive() <= params.N );
+    }
+
+    // Across many seeds, both modes give the same distribution of outcomes (compare the means of
+    // the cooperator count and the number of flips in the last epoch, within sampling error).
+    const size_t seeds = 200;
+    double coop[2] = {0.0, 0.0}, coop_sqr[2] = {0.0, 0.0}, flips[2] = {0.0, 0.0};
+    for (int mode = 0; mode < 2; mode++) {
+        emp::SimplePDWorld sample_world;
+        sample_world.SetEventDriven(mode == 1);
+        for (uint64_t seed = 0; seed < seeds; seed++) {
+            sample_world.Setup(params, 1000 + seed);
+            sample_world.Run(params.E);
+            coop[mode] += (double)sample_world.CountCoop();
+            coop_sqr[mode] += (double)sample_world.CountCoop() * (double)sample_world.CountCoop();
+            flips[mode] += (double)sample_world.GetEpochFlips();
+        }
+    }
+    const double mean0 = coop[0] / seeds, mean1 = coop[1] / seeds;
+    const double var0 = coop_sqr[0] / seeds - mean0 * mean0, var1 = coop_sqr[1] / seeds - mean1 * mean1;
+    const double std_err = std::sqrt((var0 + var1) / seeds);
+    REQUIRE( std::abs(mean0 - mean1) < 4.0 * std_err + 1.0 );
+    REQUIRE( std::abs(flips[0] - flips[1]) / seeds < 0.2 * (flips[0] / seeds) + 2.0 );
+}
+
+TEST_CASE("Cached neighborhood counts stay current as strategies flip", "[simplepdworld]")
+{
+    emp::PDParams params;
+    params.r = 0.15;
+    params.N = 500;
+    params.E = 3;
+
+    emp::SimplePDWorld world;
+    world.Setup(params, 8);
+    world.Run(params.E);
+    REQUIRE( world.GetEpochFlips() > 0 );  // Still mixed, so the counts have been through many flips
+
+    const auto coop_nbrs = world.coop_nbrs;
+    const auto sum_c_coop = world.sum_c_coop;
+    const auto sum_c_all = world.sum_c_all;
+    const auto sum_deg_coop = world.sum_deg_coop;
+    world.BuildCounts();
+    REQUIRE( world.coop_nbrs == coop_nbrs );
+    REQUIRE( world.sum_c_coop == sum_c_coop );
+    REQUIRE( world.sum_c_all == sum_c_all );
+    REQUIRE( world.sum_deg_coop == sum_deg_coop );
+
+    // The payoff of each strategy's neighbors, from the sums, matches adding up their fitnesses.
+    for (size_t id = 0; id < params.N; id++) {
+        double coop_fitness = 0.0, defect_fitness = 0.0;
+        for (uint64_t i = world.neighbor_start[id]; i < world.neighbor_start[id + 1]; i++) {
+            const uint32_t n = world.neighbor_ids[i];
+            (world.IsCoop(n) ? coop_fitness : defect_fitness) += world.GetFitness(n);
+        }
+        REQUIRE( (double)world.sum_c_coop[id] == Approx(coop_fitness) );  // payoff_CC = 1, payoff_CD = 0
+        const double defect_c = (double)(world.sum_c_all[id] - world.sum_c_coop[id]);
+        const double defect_deg = (double)(world.sum_deg_all[id] - world.sum_deg_coop[id]);
+        REQUIRE( (1.0 + params.u) * defect_c + params.u * (defect_deg - defect_c) == Approx(defect_fitness) );
+    }
+}
+
+TEST_CASE("Parallel epochs depend on the tile count but not the thread count", "[simplepdworld]")
+{
+    emp::PDParams params;
+    params.r = 0.03;
+    params.u = 0.1;
+    params.N = 3000;
+    params.E = 20;
+
+    // Tiles are even in number and wider than 4r.
+    emp::SimplePDWorld world;
+    world.Setup(params, 4);
+    world.SetParallel(100, 1);
+    REQUIRE( world.GetTilesPerSide() == 8 );
+    world.SetParallel(7, 1);
+    REQUIRE( world.GetTilesPerSide() == 6 );
+    world.SetR(0.2);
+    world.Reset();
+    REQUIRE( world.GetTilesPerSide() == 0 );  // Too large for two: the serial update
+    world.SetParallel(0);
+    REQUIRE( world.GetTilesPerSide() == 0 );
+
+    auto run = [&params](size_t tiles, size_t threads, std::stringstream& state) {
+        emp::SimplePDWorld tiled;
+        tiled.SetParallel(tiles, threads);
+        tiled.Setup(params, 11);
+        tiled.Run(params.E / 2);
+        tiled.SaveState(state);
+        tiled.Run(params.E - params.E / 2);
+        return tiled;
+    };
+    std::stringstream state1, state4, state_other;
+    const emp::SimplePDWorld one = run(8, 1, state1);
+    const emp::SimplePDWorld four = run(8, 4, state4);
+    const emp::SimplePDWorld other = run(4, 4, state_other);
+    REQUIRE( one.GetEpoch() == params.E );
+    REQUIRE( one.coop_bits == four.coop_bits );
+    REQUIRE( one.fitness == four.fitness );
+    REQUIRE( one.GetMeanFitness() == four.GetMeanFitness() );
+    REQUIRE( one.GetEpochFlips() == four.GetEpochFlips() );
+    REQUIRE( one.coop_bits != other.coop_bits );
+
+    // The running totals and cached counts stay exact.
+    emp::SimplePDWorld check = four;
+    REQUIRE( check.CountCoop() == check.RecountCoop() );
+    double fitness_sum = 0.0;
+    for (size_t id = 0; id < params.N; id++) fitness_sum += check.GetFitness(id);
+    REQUIRE( check.GetMeanFitness() * (double)params.N == Approx(fitness_sum) );
+    const auto sum_c_all = check.sum_c_all;
+    const auto sum_c_coop = check.sum_c_coop;
+    check.BuildCounts();
+    REQUIRE( check.sum_c_all == sum_c_all );
+    REQUIRE( check.sum_c_coop == sum_c_coop );
+
+    // A checkpoint taken part way continues the same, on any number of threads.
+    emp::SimplePDWorld resumed;
+    resumed.SetParallel(8, 2);
+    REQUIRE( resumed.LoadState(state1) );
+    resumed.Run(params.E - params.E / 2);
+    REQUIRE( resumed.coop_bits == one.coop_bits );
+    REQUIRE( resumed.GetMeanFitness() == one.GetMeanFitness() );
+}
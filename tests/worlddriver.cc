@@ -0,0 +1,189 @@
+#define CATCH_CONFIG_MAIN
+
+#include "Catch/single_include/catch2/catch.hpp"
+
+#include "configsetup.h"
+#include "pdsnapshot.h"
+#include "queue-manager.h"
+#include "simplepdworld.h"
+#include "worlddriver.h"
+
+// Parameters of a CountingWorld: its value starts at start and grows by step each epoch, and
+// the world stops once the value passes limit (0 for never).
+struct CountingParams {
+    double start = 0.0;
+    double step = 1.0;
+    double limit = 0.0;
+    size_t E = 0;
+};
+
+// A world that only counts (see CountingParams).
+struct CountingWorld {
+    CountingParams params;
+    size_t epoch = 0;
+    double value = 0.0;
+
+    void Setup(const CountingParams& _params, uint64_t seed) {
+        params = _params;
+        epoch = 0;
+        value = params.start + (double)(seed % 10);
+    }
+    void Run(size_t steps) {
+        for (size_t i = 0; i < steps && GetStopReason() == emp::StopReason::NONE; i++) {
+            epoch++;
+            value += params.step;
+        }
+    }
+    size_t GetEpoch() const { return epoch; }
+    emp::StopReason GetStopReason() const {
+        return params.limit > 0.0 && value > params.limit ? emp::StopReason::FIXATION : emp::StopReason::NONE;
+    }
+};
+
+namespace emp {
+template <>
+struct WorldParams<CountingWorld> {
+    using params_t = CountingParams;
+    // Every run counts by twos up past 20, for as many epochs as the queue gives it.
+    static CountingParams FromRun(const RunInfo& run) {
+        CountingParams params;
+        params.step = 2.0;
+        params.limit = 20.0;
+        params.E = run.GetParams().E;
+        return params;
+    }
+    static size_t GetEpochs(const CountingParams& params) { return params.E; }
+};
+
+template <>
+struct WorldMetrics<CountingWorld> {
+    static auto List() {
+        return std::make_tuple(MakeMetric("Value", [](const CountingWorld& world) { return world.value; }),
+                               MakeMetric("Whole", [](const CountingWorld& world) { return (int)world.value; }),
+                               MakeMetric("Epoch Parity", [](const CountingWorld& world) { return world.epoch % 2; }));
+    }
+    static double SampleValue(const CountingWorld& world) { return world.value / 100.0; }
+};
+}  // namespace emp
+
+TEST_CASE("Any world type can work through the queue", "[worlddriver]")
+{
+    const emp::SettingConfig config = emp::setup(0.02, 0.175, 100, 100);
+    emp::QueueManager queue(config);
+    emp::WorldDriver<CountingWorld> driver(queue);
+    REQUIRE( queue.GetNumMetrics() == 3 );
+    REQUIRE( queue.GetMetricName(driver.GetSlot(2)) == "Epoch Parity" );
+
+    queue.SetSummaryInterval(5);
+    queue.AddRuns(config, 3);
+
+    REQUIRE( driver.Step(3) );
+    const CountingWorld& world = driver.GetWorld();
+    REQUIRE( world.GetEpoch() == 3 );
+    REQUIRE( queue.GetMetric(driver.GetSlot(0)) == world.value );
+    REQUIRE( queue.GetMetric(driver.GetSlot(1)) == (int)world.value );
+    REQUIRE( queue.GetMetric(driver.GetSlot(2)) == 1 );
+    REQUIRE( queue.RunsRemaining() == 3 );
+
+    // Each run stops as soon as its value passes 20, well before E.
+    emp::OnlineStats final_stats;
+    for (size_t id = 0; id < 3; id++) {
+        CountingWorld expected;
+        expected.Setup(emp::WorldParams<CountingWorld>::FromRun(queue.FrontRun()), emp::CounterRandom::DeriveSeed(1, id));
+        expected.Run(100);
+        REQUIRE( expected.GetEpoch() < 100 );
+        final_stats.Add(expected.value / 100.0);
+        while (queue.RunsRemaining() == 3 - id) REQUIRE( driver.Step(2) );
+        REQUIRE( world.GetEpoch() == expected.GetEpoch() );
+    }
+    REQUIRE( queue.IsEmpty() );
+    REQUIRE( !driver.Step(1) );
+
+    emp::PointSummary summary;
+    REQUIRE( queue.GetSummary(0, summary) );
+    REQUIRE( summary.IsComplete() );
+    REQUIRE( summary.samples.size() == 20 );
+    REQUIRE( summary.samples.back().stats.count == 3 );
+    REQUIRE( summary.samples.back().stats.mean == Approx(final_stats.mean) );
+}
+
+TEST_CASE("Driven SimplePDWorld runs match running the worlds directly", "[worlddriver]")
+{
+    const emp::SettingConfig config = emp::setup(0.1, 0.175, 200, 30);
+    emp::QueueManager queue(config);
+    emp::WorldDriver<emp::SimplePDWorld> driver(queue);
+    queue.SetSummaryInterval(10);
+    queue.AddRuns(config, 4);
+
+    emp::OnlineStats final_stats;
+    for (size_t id = 0; id < 4; id++) {
+        emp::SimplePDWorld world;
+        world.Setup(emp::PDParams::FromConfig(config), emp::CounterRandom::DeriveSeed(1, id));
+        world.Run(30);
+        final_stats.Add((double)world.CountCoop() / 200.0);
+    }
+
+    while (driver.Step(7)) {
+        const emp::SimplePDWorld& world = driver.GetWorld();
+        REQUIRE( queue.GetMetric(driver.GetSlot(0)) == world.CountCoop() );
+        REQUIRE( queue.GetMetric(driver.GetSlot(1)) == world.GetN() - world.CountCoop() );
+    }
+
+    emp::PointSummary summary;
+    REQUIRE( queue.GetSummary(0, summary) );
+    REQUIRE( summary.IsComplete() );
+    REQUIRE( summary.samples.back().stats.count == 4 );
+    REQUIRE( summary.samples.back().stats.mean == Approx(final_stats.mean) );
+}
+
+TEST_CASE("Drivers run taken runs without touching the table", "[worlddriver]")
+{
+    const emp::SettingConfig config = emp::setup(0.1, 0.175, 200, 30);
+    emp::QueueManager queue(config);
+    emp::WorldDriver<emp::SimplePDWorld> driver(queue, false);
+    REQUIRE( queue.GetNumMetrics() == 0 );
+    queue.AddRuns(config, 1);
+
+    emp::RunInfo run;
+    REQUIRE( queue.PopRun(run) );
+    driver.Start(run);
+    REQUIRE( driver.GetEpochs() == 30 );
+    driver.RunTo(20);
+    REQUIRE( driver.GetWorld().GetEpoch() == 20 );
+    REQUIRE( !driver.IsDone() );
+    driver.RunTo(1000);  // Never past the run's epochs
+    REQUIRE( driver.GetWorld().GetEpoch() == 30 );
+    REQUIRE( driver.IsDone() );
+
+    emp::SimplePDWorld world;
+    world.Setup(emp::PDParams::FromConfig(config), run.seed);
+    world.Run(30);
+    REQUIRE( driver.GetSampleValue() == (double)world.CountCoop() / 200.0 );
+}
+
+TEST_CASE("Snapshots of a world report as the world does", "[worlddriver]")
+{
+    // The web page reports the snapshots its worker sends back (see queue-manager-web.cc).
+    const emp::SettingConfig config = emp::setup(0.1, 0.175, 200, 30);
+    emp::QueueManager driven(config), reported(config);
+    emp::WorldDriver<emp::SimplePDWorld> driver(driven);
+    emp::WorldReporter<emp::SimplePDWorld> reporter(reported);
+    REQUIRE( reported.GetNumMetrics() == driven.GetNumMetrics() );
+    driven.AddRuns(config, 2);
+    reported.AddRuns(config, 2);
+
+    emp::PDSnapshot snapshot;
+    while (driver.Step(7)) {
+        snapshot.Capture(driver.GetWorld(), false);
+        reporter.Report(snapshot);
+        REQUIRE( reported.RunsRemaining() == driven.RunsRemaining() );
+        for (size_t slot = 0; slot < driven.GetNumMetrics(); slot++) {
+            REQUIRE( reported.GetMetric(reporter.GetSlot(slot)) == driven.GetMetric(driver.GetSlot(slot)) );
+        }
+    }
+
+    emp::PointSummary from_world, from_snapshots;
+    REQUIRE( driven.GetSummary(0, from_world) );
+    REQUIRE( reported.GetSummary(0, from_snapshots) );
+    REQUIRE( from_snapshots.samples.back().stats.mean == from_world.samples.back().stats.mean );
+}